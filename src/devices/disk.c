@@ -6,10 +6,26 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   Data is moved by PIO, through the data register, unless the
+   controller is a PCI IDE controller that can act as a bus
+   master, such as the Intel PIIX that QEMU and Bochs emulate.
+   Then disks that support DMA transfer sectors to and from
+   memory by themselves, following a table of physical region
+   descriptors (PRDs), and interrupt once when they are done, so
+   the CPU is free to run other threads meanwhile.
+
+   Transfers are queued as requests on their disk's channel.  Each
+   channel has a dispatcher thread that carries them out one at a
+   time, in elevator order, merging requests for adjacent sectors
+   into a single command. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -32,6 +48,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -47,6 +64,40 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Bus master IDE port addresses. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus master Command Register bits. */
+#define BMC_START 0x01          /* Start transfer. */
+#define BMC_TO_MEMORY 0x08      /* Transfer from disk to memory. */
+
+/* Bus master Status Register bits. */
+#define BMS_INTR 0x04           /* Interrupt (write 1 to clear). */
+#define BMS_ERR 0x02            /* Error (write 1 to clear). */
+
+/* A physical region descriptor.  The regions listed in a PRD
+   table are transferred in order, up to the one marked PRD_EOT.
+   A region may not cross a 64 kB boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Size in bytes, 0 for 64 kB. */
+    uint16_t flags;             /* PRD_EOT, or 0. */
+  };
+#define PRD_EOT 0x8000          /* Last region in table. */
+
+/* If true (default), disks use bus-master DMA when the controller
+   and disk support it.  Set false by kernel command-line option
+   "-pio". */
+bool disk_use_dma = true;
 
 /* An ATA device. */
 struct disk 
@@ -57,6 +108,9 @@ struct disk
 
     bool is_ata;                /* 1=This device is an ATA disk. */
     disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
+    int block_sectors;          /* Sectors per interrupt (if is_ata). */
+    bool use_dma;               /* Transfer by DMA (if is_ata)? */
+    disk_sector_t head;         /* Sector past the last transfer. */
 
     long long read_cnt;         /* Number of sectors read. */
     long long write_cnt;        /* Number of sectors written. */
@@ -70,11 +124,18 @@ struct channel
     uint16_t reg_base;          /* Base I/O port. */
     uint8_t irq;                /* Interrupt in use. */
 
-    struct lock lock;           /* Must acquire to access the controller. */
+    struct lock lock;           /* Protects queue and cur_disk. */
+    struct list queue;          /* Pending disk_requests. */
+    struct condition queue_ready;       /* Signaled when queue is non-empty. */
+    struct disk *cur_disk;      /* Disk last transferred to or from. */
+
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /* Bus master base I/O port, or 0. */
+    struct prd *prdt;           /* PRD table, if bm_base != 0. */
+
     struct disk devices[2];     /* The devices on this channel. */
   };
 
@@ -85,11 +146,21 @@ static struct channel channels[CHANNEL_CNT];
 static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
+static void set_multiple_mode (struct disk *, int max);
+static uint16_t find_bus_master (void);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sectors (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void input_sectors (struct channel *, void *, size_t cnt);
+static void output_sectors (struct channel *, const void *, size_t cnt);
+static void transfer_sync (struct disk *, disk_sector_t, void *,
+                           size_t cnt, bool write);
+static thread_func dispatcher;
+static void pio_transfer (struct disk *, disk_sector_t, size_t cnt,
+                          struct list *batch, bool write);
+static bool can_dma (const struct disk *, struct list *batch);
+static void dma_transfer (struct disk *, disk_sector_t, size_t cnt,
+                          struct list *batch, bool write);
 
 static void wait_until_idle (const struct disk *);
 static bool wait_while_busy (const struct disk *);
@@ -102,6 +173,7 @@ static void interrupt_handler (struct intr_frame *);
 void
 disk_init (void) 
 {
+  uint16_t bm_base = disk_use_dma ? find_bus_master () : 0;
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -125,8 +197,15 @@ disk_init (void)
           NOT_REACHED ();
         }
       lock_init (&c->lock);
+      list_init (&c->queue);
+      cond_init (&c->queue_ready);
+      c->cur_disk = &c->devices[0];
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+
+      /* Each channel has 8 bus master ports. */
+      c->bm_base = bm_base != 0 ? bm_base + chan_no * 8 : 0;
+      c->prdt = c->bm_base != 0 ? palloc_get_page (PAL_ASSERT) : NULL;
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -138,6 +217,9 @@ disk_init (void)
 
           d->is_ata = false;
           d->capacity = 0;
+          d->block_sectors = 1;
+          d->use_dma = false;
+          d->head = 0;
 
           d->read_cnt = d->write_cnt = 0;
         }
@@ -156,6 +238,9 @@ disk_init (void)
       for (dev_no = 0; dev_no < 2; dev_no++)
         if (c->devices[dev_no].is_ata)
           identify_ata_device (&c->devices[dev_no]);
+
+      /* Start carrying out requests. */
+      thread_create (c->name, PRI_MAX, dispatcher, c);
     }
 }
 
@@ -219,21 +304,7 @@ disk_size (struct disk *d)
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) 
 {
-  struct channel *c;
-  
-  ASSERT (d != NULL);
-  ASSERT (buffer != NULL);
-
-  c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  d->read_cnt++;
-  lock_release (&c->lock);
+  disk_read_multi (d, sec_no, buffer, 1);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -243,23 +314,361 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer)
    per-disk locking is unneeded. */
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer)
+{
+  disk_write_multi (d, sec_no, buffer, 1);
+}
+
+/* Reads the CNT consecutive sectors starting at SEC_NO from disk
+   D into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  Submits requests of up to DISK_TRANSFER_MAX sectors
+   and waits for each to complete.  Internally synchronizes
+   accesses to disks, so external per-disk locking is unneeded. */
+void
+disk_read_multi (struct disk *d, disk_sector_t sec_no, void *buffer,
+                 size_t cnt)
+{
+  transfer_sync (d, sec_no, buffer, cnt, false);
+}
+
+/* Writes the CNT consecutive sectors starting at SEC_NO on disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes.
+   Returns after the disk has acknowledged receiving the data.
+   Works like disk_read_multi(). */
+void
+disk_write_multi (struct disk *d, disk_sector_t sec_no, const void *buffer,
+                  size_t cnt)
+{
+  transfer_sync (d, sec_no, (void *) buffer, cnt, true);
+}
+
+/* Queues request R to be carried out by its disk's channel, and
+   returns without waiting for it.  R->done will be called, from
+   another thread, once the transfer is complete.  R must remain
+   valid until then.  Must not be called from an interrupt
+   handler. */
+void
+disk_submit (struct disk_request *r)
 {
   struct channel *c;
-  
+
+  ASSERT (r != NULL && r->disk != NULL && r->buffer != NULL);
+  ASSERT (r->cnt > 0 && r->cnt <= DISK_TRANSFER_MAX);
+  ASSERT (r->sector < r->disk->capacity
+          && r->cnt <= r->disk->capacity - r->sector);
+  ASSERT (r->done != NULL);
+
+  c = r->disk->channel;
+  lock_acquire (&c->lock);
+  list_push_back (&c->queue, &r->elem);
+  cond_signal (&c->queue_ready, &c->lock);
+  lock_release (&c->lock);
+}
+
+/* Completion function of the requests made by transfer_sync(). */
+static void
+wake_up (struct disk_request *r)
+{
+  sema_up (r->aux);
+}
+
+/* Transfers the CNT sectors starting at SEC_NO on disk D to
+   BUFFER, or from it if WRITE is true, and waits until done. */
+static void
+transfer_sync (struct disk *d, disk_sector_t sec_no, void *buffer,
+               size_t cnt, bool write)
+{
+  struct disk_request r;
+  struct semaphore done;
+
   ASSERT (d != NULL);
   ASSERT (buffer != NULL);
 
-  c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
+  sema_init (&done, 0);
+  while (cnt > 0)
+    {
+      r.disk = d;
+      r.sector = sec_no;
+      r.cnt = cnt < DISK_TRANSFER_MAX ? cnt : DISK_TRANSFER_MAX;
+      r.buffer = buffer;
+      r.write = write;
+      r.done = wake_up;
+      r.aux = &done;
+      disk_submit (&r);
+      sema_down (&done);
+
+      sec_no += r.cnt;
+      buffer = (uint8_t *) buffer + r.cnt * DISK_SECTOR_SIZE;
+      cnt -= r.cnt;
+    }
+}
+
+/* Request scheduling. */
+
+/* Returns the request queued on channel C for disk D with the
+   lowest sector at or past POS, or a null pointer if there is
+   none.  The caller must hold C's lock. */
+static struct disk_request *
+scan_queue (struct channel *c, const struct disk *d, disk_sector_t pos)
+{
+  struct disk_request *best = NULL;
+  struct list_elem *e;
+
+  for (e = list_begin (&c->queue); e != list_end (&c->queue);
+       e = list_next (e))
+    {
+      struct disk_request *r = list_entry (e, struct disk_request, elem);
+      if (r->disk == d && r->sector >= pos
+          && (best == NULL || r->sector < best->sector))
+        best = r;
+    }
+  return best;
+}
+
+/* Returns the request queued on channel C that comes right after
+   the sectors ending at END on the disk and in the direction of
+   request R, or a null pointer if there is none.  The caller must
+   hold C's lock. */
+static struct disk_request *
+find_adjacent (struct channel *c, const struct disk_request *r,
+               disk_sector_t end)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&c->queue); e != list_end (&c->queue);
+       e = list_next (e))
+    {
+      struct disk_request *next = list_entry (e, struct disk_request, elem);
+      if (next->disk == r->disk && next->write == r->write
+          && next->sector == end)
+        return next;
+    }
+  return NULL;
+}
+
+/* Removes the next requests to carry out from channel C's queue,
+   which must not be empty, and moves them into BATCH in sector
+   order.  Returns the total number of sectors in BATCH.  The
+   caller must hold C's lock.
+
+   Requests are taken in C-SCAN order: each disk's head sweeps
+   toward higher sectors, taking the closest request ahead of it,
+   and once there is none, the other disk on the channel gets its
+   turn, or the head returns to the lowest requested sector.
+   Requests that continue the chosen one on disk, in the same
+   direction, are merged with it into a single transfer of up to
+   DISK_TRANSFER_MAX sectors. */
+static size_t
+take_batch (struct channel *c, struct list *batch)
+{
+  struct disk *d = c->cur_disk;
+  struct disk *other = &c->devices[!d->dev_no];
+  struct disk_request *r;
+  size_t cnt;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+  ASSERT (!list_empty (&c->queue));
+
+  r = scan_queue (c, d, d->head);
+  if (r == NULL)
+    r = scan_queue (c, other, other->head);
+  if (r == NULL)
+    r = scan_queue (c, other, 0);
+  if (r == NULL)
+    r = scan_queue (c, d, 0);
+  ASSERT (r != NULL);
+  c->cur_disk = d = r->disk;
+
+  list_init (batch);
+  cnt = 0;
+  do
+    {
+      list_remove (&r->elem);
+      list_push_back (batch, &r->elem);
+      cnt += r->cnt;
+      r = find_adjacent (c, r, r->sector + r->cnt);
+    }
+  while (r != NULL && cnt + r->cnt <= DISK_TRANSFER_MAX);
+
+  d->head = list_entry (list_front (batch),
+                        struct disk_request, elem)->sector + cnt;
+  return cnt;
+}
+
+/* Carries out the requests queued on channel C, one batch at a
+   time, for as long as the system runs.  This is the only thread
+   that programs C once disk_init() is done. */
+static void
+dispatcher (void *c_)
+{
+  struct channel *c = c_;
+
+  for (;;)
+    {
+      struct disk_request *first;
+      struct list batch;
+      size_t cnt;
+
+      lock_acquire (&c->lock);
+      while (list_empty (&c->queue))
+        cond_wait (&c->queue_ready, &c->lock);
+      cnt = take_batch (c, &batch);
+      lock_release (&c->lock);
+
+      first = list_entry (list_front (&batch), struct disk_request, elem);
+      if (can_dma (first->disk, &batch))
+        dma_transfer (first->disk, first->sector, cnt, &batch, first->write);
+      else
+        pio_transfer (first->disk, first->sector, cnt, &batch, first->write);
+      if (first->write)
+        first->disk->write_cnt += cnt;
+      else
+        first->disk->read_cnt += cnt;
+
+      while (!list_empty (&batch))
+        {
+          struct disk_request *r = list_entry (list_pop_front (&batch),
+                                               struct disk_request, elem);
+          r->done (r);
+        }
+    }
+}
+
+/* Transfers the CNT sectors starting at SEC_NO on disk D to the
+   buffers of the requests in BATCH, in order, or from them if
+   WRITE is true, by PIO, with a single command.  If D supports
+   READ MULTIPLE and WRITE MULTIPLE, the disk interrupts once per
+   block of D's block_sectors sectors, otherwise once per sector.
+   A block may span the buffers of more than one request, so data
+   is moved a sector at a time. */
+static void
+pio_transfer (struct disk *d, disk_sector_t sec_no, size_t cnt,
+              struct list *batch, bool write)
+{
+  struct channel *c = d->channel;
+  struct list_elem *e = list_begin (batch);
+  size_t ofs = 0;               /* Sectors done in E's request. */
+  size_t done, block, i;
+
+  select_sectors (d, sec_no, cnt);
+  if (write)
+    issue_pio_command (c, d->block_sectors > 1
+                       ? CMD_WRITE_MULTIPLE : CMD_WRITE_SECTOR_RETRY);
+  else
+    issue_pio_command (c, d->block_sectors > 1
+                       ? CMD_READ_MULTIPLE : CMD_READ_SECTOR_RETRY);
+  for (done = 0; done < cnt; done += block)
+    {
+      block = cnt - done;
+      if (block > (size_t) d->block_sectors)
+        block = d->block_sectors;
+
+      /* When reading, the disk interrupts once each block is
+         ready.  When writing, it interrupts after each block, once
+         it is ready for the next one or, after the last, once it
+         is done. */
+      if (!write)
+        sema_down (&c->completion_wait);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk %s failed, sector=%"PRDSNu,
+               d->name, write ? "write" : "read", sec_no + done);
+      for (i = 0; i < block; i++)
+        {
+          struct disk_request *r = list_entry (e, struct disk_request, elem);
+          uint8_t *p = (uint8_t *) r->buffer + ofs * DISK_SECTOR_SIZE;
+
+          if (write)
+            output_sectors (c, p, 1);
+          else
+            input_sectors (c, p, 1);
+          if (++ofs == r->cnt)
+            {
+              e = list_next (e);
+              ofs = 0;
+            }
+        }
+      if (write)
+        sema_down (&c->completion_wait);
+    }
+}
+
+/* Returns true if the buffers of the requests in BATCH can be
+   transferred to or from disk D by DMA.  The controller reaches
+   memory by physical address, so each buffer must be in kernel
+   memory, where virtual addresses map directly to physical ones,
+   and it must be word-aligned. */
+static bool
+can_dma (const struct disk *d, struct list *batch)
+{
+  struct list_elem *e;
+
+  if (!d->use_dma)
+    return false;
+  for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+    {
+      struct disk_request *r = list_entry (e, struct disk_request, elem);
+      if (!is_kernel_vaddr (r->buffer) || ((uintptr_t) r->buffer & 1) != 0)
+        return false;
+    }
+  return true;
+}
+
+/* Transfers the CNT sectors starting at SEC_NO on disk D to the
+   buffers of the requests in BATCH, in order, or from them if
+   WRITE is true, by bus-master DMA.  can_dma() must be true of D
+   and BATCH. */
+static void
+dma_transfer (struct disk *d, disk_sector_t sec_no, size_t cnt,
+              struct list *batch, bool write)
+{
+  struct channel *c = d->channel;
+  uint8_t command = write ? 0 : BMC_TO_MEMORY;
+  struct prd *prd = c->prdt;
+  struct list_elem *e;
+  uint8_t status;
+
+  /* Describe each buffer, split at 64 kB boundaries.  A batch
+     holds at most DISK_TRANSFER_MAX sectors, so the table, which
+     fills a page, cannot overflow. */
+  for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+    {
+      struct disk_request *r = list_entry (e, struct disk_request, elem);
+      uintptr_t addr = vtop (r->buffer);
+      size_t size = r->cnt * DISK_SECTOR_SIZE;
+
+      while (size > 0)
+        {
+          size_t region = 0x10000 - (addr & 0xffff);
+          if (region > size)
+            region = size;
+          prd->addr = addr;
+          prd->size = region & 0xffff;
+          prd->flags = 0;
+          addr += region;
+          size -= region;
+          prd++;
+        }
+    }
+  prd[-1].flags = PRD_EOT;
+
+  /* Program the controller, clearing any earlier error or
+     interrupt, then start the disk and the transfer. */
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_command (c), command);
+  outb (reg_bm_status (c), inb (reg_bm_status (c)) | BMS_ERR | BMS_INTR);
+  select_sectors (d, sec_no, cnt);
+  issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (reg_bm_command (c), command | BMC_START);
+
+  /* Wait for the disk to interrupt, then stop the controller. */
   sema_down (&c->completion_wait);
-  d->write_cnt++;
-  lock_release (&c->lock);
+  outb (reg_bm_command (c), command);
+  status = inb (reg_bm_status (c));
+  outb (reg_bm_status (c), status | BMS_ERR | BMS_INTR);
+  if ((status & BMS_ERR) != 0 || (inb (reg_alt_status (c)) & STA_ERR) != 0)
+    PANIC ("%s: disk %s failed, sector=%"PRDSNu,
+           d->name, write ? "write" : "read", sec_no);
 }
+
 
 /* Disk detection and identification. */
 
@@ -381,11 +790,18 @@ identify_ata_device (struct disk *d)
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sectors (c, id, 1);
 
   /* Calculate capacity. */
   d->capacity = id[60] | ((uint32_t) id[61] << 16);
 
+  /* Word 47 gives the most sectors per block that READ MULTIPLE
+     and WRITE MULTIPLE support, or 0 if they are not supported. */
+  set_multiple_mode (d, id[47] & 0xff);
+
+  /* Bit 8 of word 49 tells whether the disk supports DMA. */
+  d->use_dma = c->bm_base != 0 && (id[49] & 0x100) != 0;
+
   /* Print identification message. */
   printf ("%s: detected %'"PRDSNu" sector (", d->name, d->capacity);
   if (d->capacity > 1024 / DISK_SECTOR_SIZE * 1024 * 1024)
@@ -401,7 +817,94 @@ identify_ata_device (struct disk *d)
   print_ata_string ((char *) &id[27], 40);
   printf ("\", serial \"");
   print_ata_string ((char *) &id[10], 20);
-  printf ("\"\n");
+  printf ("\"%s\n", d->use_dma ? ", DMA" : "");
+}
+
+/* Sets the number of sectors that disk D transfers per interrupt
+   with READ MULTIPLE and WRITE MULTIPLE to the largest power of 2
+   no greater than MAX, and stores it in D's block_sectors member.
+   Leaves block_sectors at 1, so that those commands are not used,
+   if MAX is less than 2 or the disk rejects the setting. */
+static void
+set_multiple_mode (struct disk *d, int max)
+{
+  struct channel *c = d->channel;
+  int cnt;
+
+  if (max < 2)
+    return;
+  for (cnt = 1; cnt * 2 <= max; cnt *= 2)
+    continue;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), cnt);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_alt_status (c)) & STA_ERR) == 0)
+    d->block_sectors = cnt;
+}
+
+/* PCI configuration space access ports. */
+#define PCI_CONFIG_ADDRESS 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* Returns the 32-bit PCI configuration register at byte offset
+   REG of function FUNC of device DEV on PCI bus 0. */
+static uint32_t
+pci_read_config (int dev, int func, int reg)
+{
+  outl (PCI_CONFIG_ADDRESS, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Sets the 32-bit PCI configuration register at byte offset REG
+   of function FUNC of device DEV on PCI bus 0 to VALUE. */
+static void
+pci_write_config (int dev, int func, int reg, uint32_t value)
+{
+  outl (PCI_CONFIG_ADDRESS, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks on PCI bus 0, where the PIIX and its kin sit, for an IDE
+   controller that drives the legacy channels and can act as a bus
+   master.  If there is one, enables bus mastering and returns its
+   bus master base I/O port, which is channel 0's; channel 1's
+   ports follow.  Otherwise, returns 0. */
+static uint16_t
+find_bus_master (void)
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++)
+      {
+        uint32_t class, bar, command;
+
+        if ((pci_read_config (dev, func, 0x00) & 0xffff) == 0xffff)
+          continue;
+
+        /* Mass storage, IDE, bus master capable, and with both
+           channels in compatibility mode at the legacy ports. */
+        class = pci_read_config (dev, func, 0x08) >> 8;
+        if ((class & 0xffff00) != 0x010100
+            || (class & 0x80) == 0 || (class & 0x05) != 0)
+          continue;
+
+        /* BAR 4 holds the bus master ports, in I/O space. */
+        bar = pci_read_config (dev, func, 0x20);
+        if ((bar & 1) == 0 || (bar & 0xfffc) == 0)
+          continue;
+
+        /* Enable I/O space access and bus mastering.  The upper
+           half is the status register, whose bits are cleared by
+           writing 1s, so it is written as 0. */
+        command = pci_read_config (dev, func, 0x04) & 0xffff;
+        pci_write_config (dev, func, 0x04, command | 0x0005);
+        return bar & 0xfffc;
+      }
+  return 0;
 }
 
 /* Prints STRING, which consists of SIZE bytes in a funky format:
@@ -426,18 +929,19 @@ print_ata_string (char *string, size_t size)
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT to the disk's sector selection and sector
+   count registers.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) 
+select_sectors (struct disk *d, disk_sector_t sec_no, size_t cnt) 
 {
   struct channel *c = d->channel;
 
-  ASSERT (sec_no < d->capacity);
-  ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt > 0 && cnt <= DISK_TRANSFER_MAX);
+  ASSERT (sec_no < d->capacity && cnt <= d->capacity - sec_no);
+  ASSERT (sec_no + cnt <= (1UL << 28));
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt % DISK_TRANSFER_MAX);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -458,20 +962,21 @@ issue_pio_command (struct channel *c, uint8_t command)
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for DISK_SECTOR_SIZE bytes. */
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector) 
+input_sectors (struct channel *c, void *sectors, size_t cnt) 
 {
-  insw (reg_data (c), sector, DISK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sectors, cnt * DISK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain DISK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors from SECTORS to channel C's data register in
+   PIO mode.  SECTORS must contain CNT * DISK_SECTOR_SIZE bytes. */
 static void
-output_sector (struct channel *c, const void *sector) 
+output_sectors (struct channel *c, const void *sectors, size_t cnt) 
 {
-  outsw (reg_data (c), sector, DISK_SECTOR_SIZE / 2);
+  outsw (reg_data (c), sectors, cnt * DISK_SECTOR_SIZE / 2);
 }
 
 /* Low-level ATA primitives. */
@@ -2,6 +2,9 @@
 #define DEVICES_DISK_H
 
 #include <inttypes.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /* Size of a disk sector in bytes. */
@@ -15,6 +18,32 @@ typedef uint32_t disk_sector_t;
    printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
 
+/* Largest number of sectors in a single request.  A sector count
+   of 0 in the Sector Count register means this many. */
+#define DISK_TRANSFER_MAX 256
+
+/* A request to transfer CNT consecutive sectors, starting at
+   SECTOR on DISK, to BUFFER, or from it if WRITE is true.  DONE is
+   called with the request, from the channel's dispatcher thread,
+   once the transfer is complete. */
+struct disk_request;
+typedef void disk_done_func (struct disk_request *);
+struct disk_request
+  {
+    struct disk *disk;          /* Disk to transfer to or from. */
+    disk_sector_t sector;       /* First sector. */
+    size_t cnt;                 /* Number of sectors, at most
+                                   DISK_TRANSFER_MAX. */
+    void *buffer;               /* CNT * DISK_SECTOR_SIZE bytes. */
+    bool write;                 /* True to write, false to read. */
+    disk_done_func *done;       /* Called when complete. */
+    void *aux;                  /* For use by DONE. */
+    struct list_elem elem;      /* Element in channel's queue. */
+  };
+
+/* If true, disks use bus-master DMA when they can. */
+extern bool disk_use_dma;
+
 void disk_init (void);
 void disk_print_stats (void);
 
@@ -22,5 +51,9 @@ struct disk *disk_get (int chan_no, int dev_no);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
+void disk_read_multi (struct disk *, disk_sector_t, void *, size_t cnt);
+void disk_write_multi (struct disk *, disk_sector_t, const void *,
+                       size_t cnt);
+void disk_submit (struct disk_request *);
 
 #endif /* devices/disk.h */
@@ -104,9 +104,17 @@ timer_sleep (int64_t ticks)
    sleep. The current thread is saved in the sleeping_threads
    semaphore. */
   struct sleeping_thread new;
+  enum intr_level old_level;
+
   new.ticks = timer_ticks () + ticks;
-  add_sorted (&new.elem);
   sema_init (&new.binary, 0);
+
+  /* The timer interrupt walks sleep_list, so it must not fire
+     while we insert into it. */
+  old_level = intr_disable ();
+  add_sorted (&new.elem);
+  intr_set_level (old_level);
+
   sema_down (&new.binary);
 }
 
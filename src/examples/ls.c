@@ -24,38 +24,44 @@ list_dir (const char *dir, bool verbose)
 
   if (isdir (dir_fd))
     {
-      char name[READDIR_MAX_LEN];
+      struct dirent entries[16];
+      int entry_cnt;
 
       printf ("%s", dir);
       if (verbose)
         printf (" (inumber %d)", inumber (dir_fd));
       printf (":\n");
 
-      while (readdir (dir_fd, name)) 
+      while ((entry_cnt = getdents (dir_fd, entries, 16)) > 0) 
         {
-          printf ("%s", name); 
-          if (verbose) 
-            {
-              char full_name[128];
-              int entry_fd;
+          int i;
 
-              snprintf (full_name, sizeof full_name, "%s/%s", dir, name);
-              entry_fd = open (full_name);
+          for (i = 0; i < entry_cnt; i++) 
+            {
+              const struct dirent *e = &entries[i];
 
-              printf (": ");
-              if (entry_fd != -1)
+              printf ("%s", e->d_name); 
+              if (verbose && e->d_is_dir) 
+                printf (": directory, inumber %d", e->d_ino);
+              else if (verbose) 
                 {
-                  if (isdir (entry_fd))
-                    printf ("directory");
+                  char full_name[128];
+                  int entry_fd;
+
+                  snprintf (full_name, sizeof full_name, "%s/%s",
+                            dir, e->d_name);
+                  entry_fd = open (full_name);
+
+                  printf (": ");
+                  if (entry_fd != -1)
+                    printf ("%d-byte file, inumber %d",
+                            filesize (entry_fd), e->d_ino);
                   else
-                    printf ("%d-byte file", filesize (entry_fd));
-                  printf (", inumber %d", inumber (entry_fd));
+                    printf ("open failed");
+                  close (entry_fd);
                 }
-              else
-                printf ("open failed");
-              close (entry_fd);
+              printf ("\n");
             }
-          printf ("\n");
         }
     }
   else 
@@ -30,13 +30,24 @@ int main(void)
 	random_init((int)seed[0]);
 	len = strlen(pfswriter);
 
-	ret = create("file.1", BIG * TIMES);
+	ret = create("file.1", 0);
 
 	if (!ret)  {
 		printf("Failed to create file.1\n");
 		exit(-1);
 	}
 
+	/* Lay the whole file out on disk now, in one run, rather than
+	   wherever the writers' random offsets happen to allocate it.
+	   The file starts out empty, so that this both sets its length
+	   and zeroes each new sector, once. */
+	ret = open("file.1");
+	if (ret < 0 || !fallocate(ret, 0, 0, BIG * TIMES)) {
+		printf("Failed to allocate file.1\n");
+		exit(-1);
+	}
+	close(ret);
+
 	for (i = 0; i < N_PROC; i++) {
 		if(random_ulong() % 2 == 0)	 {
 			pfswriter[len] = seed[i];
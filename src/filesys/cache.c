@@ -0,0 +1,668 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* The buffer cache sits between the file system and the disk
+   driver.  It holds up to CACHE_SIZE sectors of the file system
+   disk and writes modified sectors back only when they are
+   evicted or explicitly flushed.
+
+   Each entry is "pinned" by every thread that is using it, so
+   that the clock algorithm never evicts a sector that someone
+   is in the middle of reading or writing.  Pinning is done
+   under cache_lock, while the sector data itself is protected
+   by the entry's own lock, so that a slow disk read into one
+   entry does not stop other threads from using the rest of the
+   cache.
+
+   Sectors that a sequential reader is likely to want next are
+   queued with cache_read_ahead() and brought in by a background
+   thread, so that the reader's next request hits in the cache
+   and its processing overlaps with the disk transfer.
+
+   A write-behind thread wakes up periodically and writes back
+   sectors that have been dirty for longer than cache_flush_age,
+   which bounds how much data a crash can lose without making
+   writers wait for the disk.
+
+   A sector written with cache_write_logged_at() belongs to the
+   running journal transaction (see journal.c).  It is "logged"
+   until the transaction commits, and must not be written back
+   to its home location before then, so eviction and write-back
+   pass it over.  cache_unlog() releases all logged sectors once
+   their copies are safely in the journal.
+
+   A sector written with cache_write_delayed_at() holds file data
+   that has no disk sector yet (see inode.c).  It is cached under
+   a stand-in sector number that must never reach the disk, so it
+   is "delayed", and passed over like a logged sector, until
+   cache_assign() gives it its real sector or cache_discard()
+   drops it.
+
+   Logged and delayed sectors are limited to CACHE_LOGGED_MAX and
+   CACHE_DELAYED_MAX, so that they never fill the cache. */
+
+/* A cached disk sector. */
+struct cache_entry
+  {
+    disk_sector_t sector;               /* Cached sector, if in_use. */
+    bool in_use;                        /* Does this entry hold a sector? */
+    bool accessed;                      /* Used since the clock hand passed? */
+    bool dirty;                         /* Modified since read from disk? */
+    bool logged;                        /* Modified by an uncommitted
+                                           transaction? */
+    bool delayed;                       /* Not on disk yet? */
+    int64_t dirty_time;                 /* Timer tick when made dirty. */
+    int pin_cnt;                        /* Number of threads using entry. */
+    struct lock lock;                   /* Protects data, dirty,
+                                           dirty_time, logged and
+                                           delayed. */
+    uint8_t data[DISK_SECTOR_SIZE];     /* Sector contents. */
+  };
+
+static struct cache_entry cache[CACHE_SIZE];
+
+/* Protects in_use, sector, accessed and pin_cnt of every entry,
+   and the clock hand. */
+static struct lock cache_lock;
+
+/* Broadcast whenever an entry's pin count drops to zero, and
+   when logged entries are released. */
+static struct condition entry_unpinned;
+
+/* Number of logged entries.  Protected by cache_lock. */
+static size_t logged_cnt;
+
+/* Next entry to be considered for eviction. */
+static size_t clock_hand;
+
+/* Maximum number of sectors waiting to be read ahead.  Further
+   requests are dropped until the read-ahead thread catches up. */
+#define READ_AHEAD_MAX 32
+
+/* Sectors queued for read-ahead, as a circular buffer. */
+static disk_sector_t read_ahead_queue[READ_AHEAD_MAX];
+static size_t read_ahead_head;          /* Next sector to read. */
+static size_t read_ahead_cnt;           /* Number of queued sectors. */
+static struct lock read_ahead_lock;     /* Protects the queue. */
+static struct condition read_ahead_ready;   /* Signaled on enqueue. */
+
+/* How often the write-behind thread wakes up, in timer ticks. */
+#define FLUSH_PERIOD (TIMER_FREQ / 2)
+
+int64_t cache_flush_age = CACHE_FLUSH_AGE_DEFAULT;
+
+static thread_func read_ahead_daemon NO_RETURN;
+static thread_func write_behind_daemon NO_RETURN;
+static void flush_entries (int64_t min_age);
+static struct cache_entry *cache_find (disk_sector_t);
+static struct cache_entry *cache_get (disk_sector_t, bool load);
+static void write_back (struct cache_entry *);
+static void cache_put (struct cache_entry *, bool dirty, bool logged);
+
+/* Initializes the buffer cache. */
+void
+cache_init (void)
+{
+  size_t i;
+
+  lock_init (&cache_lock);
+  cond_init (&entry_unpinned);
+  clock_hand = 0;
+  logged_cnt = 0;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &cache[i];
+      e->in_use = false;
+      e->accessed = false;
+      e->dirty = false;
+      e->logged = false;
+      e->delayed = false;
+      e->pin_cnt = 0;
+      lock_init (&e->lock);
+    }
+
+  read_ahead_head = read_ahead_cnt = 0;
+  lock_init (&read_ahead_lock);
+  cond_init (&read_ahead_ready);
+  thread_create ("read-ahead", PRI_DEFAULT, read_ahead_daemon, NULL);
+  thread_create ("write-behind", PRI_DEFAULT, write_behind_daemon, NULL);
+}
+
+/* Writes every dirty sector back to disk.  Called when the file
+   system shuts down. */
+void
+cache_done (void)
+{
+  cache_flush ();
+}
+
+/* Reads sector SECTOR into BUFFER, which must have room for
+   DISK_SECTOR_SIZE bytes. */
+void
+cache_read (disk_sector_t sector, void *buffer)
+{
+  cache_read_at (sector, buffer, DISK_SECTOR_SIZE, 0);
+}
+
+/* Reads SIZE bytes starting at byte OFFSET within sector SECTOR
+   into BUFFER. */
+void
+cache_read_at (disk_sector_t sector, void *buffer, off_t size, off_t offset)
+{
+  struct cache_entry *e;
+
+  ASSERT (offset >= 0 && size >= 0);
+  ASSERT (offset + size <= DISK_SECTOR_SIZE);
+
+  e = cache_get (sector, true);
+  memcpy (buffer, e->data + offset, size);
+  cache_put (e, false, false);
+}
+
+/* Writes sector SECTOR from BUFFER, which must contain
+   DISK_SECTOR_SIZE bytes. */
+void
+cache_write (disk_sector_t sector, const void *buffer)
+{
+  cache_write_at (sector, buffer, DISK_SECTOR_SIZE, 0);
+}
+
+/* Writes SIZE bytes from BUFFER into sector SECTOR, starting at
+   byte OFFSET within the sector.  The rest of the sector is
+   preserved. */
+void
+cache_write_at (disk_sector_t sector, const void *buffer,
+                off_t size, off_t offset)
+{
+  struct cache_entry *e;
+
+  ASSERT (offset >= 0 && size >= 0);
+  ASSERT (offset + size <= DISK_SECTOR_SIZE);
+
+  /* A write that covers the whole sector does not need the old
+     contents from disk. */
+  e = cache_get (sector, size < DISK_SECTOR_SIZE);
+  memcpy (e->data + offset, buffer, size);
+  cache_put (e, true, false);
+}
+
+/* Writes SIZE bytes from BUFFER into sector SECTOR, starting at
+   byte OFFSET within the sector, as part of the running journal
+   transaction.  The sector is not written back to disk until
+   cache_unlog() is called.  Returns true if SECTOR was not logged
+   before, false if it already was. */
+bool
+cache_write_logged_at (disk_sector_t sector, const void *buffer,
+                       off_t size, off_t offset)
+{
+  struct cache_entry *e;
+  bool newly_logged;
+
+  ASSERT (offset >= 0 && size >= 0);
+  ASSERT (offset + size <= DISK_SECTOR_SIZE);
+
+  e = cache_get (sector, size < DISK_SECTOR_SIZE);
+  newly_logged = !e->logged;
+  memcpy (e->data + offset, buffer, size);
+  cache_put (e, true, true);
+  return newly_logged;
+}
+
+/* Writes SIZE bytes from BUFFER into delayed sector SECTOR,
+   starting at byte OFFSET within the sector.  SECTOR is a
+   stand-in that does not name a disk sector.  If it is not
+   cached yet, it starts out as zeros.  It is not written back to
+   disk until cache_assign() is called. */
+void
+cache_write_delayed_at (disk_sector_t sector, const void *buffer,
+                        off_t size, off_t offset)
+{
+  struct cache_entry *e;
+
+  ASSERT (offset >= 0 && size >= 0);
+  ASSERT (offset + size <= DISK_SECTOR_SIZE);
+
+  /* Delayed entries are never evicted, so one that is not
+     delayed was just created. */
+  e = cache_get (sector, false);
+  if (!e->delayed)
+    {
+      memset (e->data, 0, DISK_SECTOR_SIZE);
+      e->delayed = true;
+    }
+  memcpy (e->data + offset, buffer, size);
+  cache_put (e, true, false);
+}
+
+/* Returns the entry for SECTOR once no thread has it pinned, or a
+   null pointer if SECTOR is not cached.  The caller must hold
+   cache_lock. */
+static struct cache_entry *
+find_unpinned (disk_sector_t sector)
+{
+  struct cache_entry *e;
+
+  while ((e = cache_find (sector)) != NULL && e->pin_cnt > 0)
+    cond_wait (&entry_unpinned, &cache_lock);
+  return e;
+}
+
+/* Drops entry E from the cache without writing it back.  E must
+   not be pinned.  The caller must hold cache_lock. */
+static void
+drop (struct cache_entry *e)
+{
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+  ASSERT (e->pin_cnt == 0);
+
+  if (e->logged)
+    logged_cnt--;
+  e->in_use = e->dirty = e->logged = e->delayed = false;
+}
+
+/* Moves the data of delayed sector TEMP, which must be cached,
+   to newly allocated disk sector SECTOR, to be written back like
+   any other dirty sector.  SECTOR was free until now, so whatever
+   the cache holds for it is stale and is dropped. */
+void
+cache_assign (disk_sector_t temp, disk_sector_t sector)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  e = find_unpinned (sector);
+  if (e != NULL)
+    drop (e);
+  e = find_unpinned (temp);
+  ASSERT (e != NULL && e->delayed);
+
+  /* An unpinned entry's lock is free, and cache_lock keeps other
+     threads from pinning it, so it can be changed without it. */
+  e->sector = sector;
+  e->delayed = false;
+  lock_release (&cache_lock);
+}
+
+/* Drops delayed sector TEMP from the cache, if it is there,
+   without writing it anywhere. */
+void
+cache_discard (disk_sector_t temp)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  e = find_unpinned (temp);
+  if (e != NULL)
+    {
+      ASSERT (e->delayed);
+      drop (e);
+    }
+  lock_release (&cache_lock);
+}
+
+/* Returns the number of logged sectors in the cache. */
+size_t
+cache_logged_cnt (void)
+{
+  size_t cnt;
+
+  lock_acquire (&cache_lock);
+  cnt = logged_cnt;
+  lock_release (&cache_lock);
+  return cnt;
+}
+
+/* Stores the numbers of up to MAX logged sectors into SECTORS
+   and returns the number stored. */
+size_t
+cache_logged (disk_sector_t sectors[], size_t max)
+{
+  size_t cnt = 0;
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE && cnt < max; i++)
+    {
+      struct cache_entry *e = &cache[i];
+
+      lock_acquire (&cache_lock);
+      if (!e->in_use)
+        {
+          lock_release (&cache_lock);
+          continue;
+        }
+      e->pin_cnt++;
+      lock_release (&cache_lock);
+
+      lock_acquire (&e->lock);
+      if (e->logged)
+        sectors[cnt++] = e->sector;
+      cache_put (e, false, false);
+    }
+  return cnt;
+}
+
+/* Releases every logged sector, so that it is written back like
+   any other dirty sector. */
+void
+cache_unlog (void)
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &cache[i];
+
+      lock_acquire (&cache_lock);
+      if (!e->in_use)
+        {
+          lock_release (&cache_lock);
+          continue;
+        }
+      e->pin_cnt++;
+      lock_release (&cache_lock);
+
+      lock_acquire (&e->lock);
+      e->logged = false;
+      cache_put (e, false, false);
+    }
+
+  lock_acquire (&cache_lock);
+  logged_cnt = 0;
+  cond_broadcast (&entry_unpinned, &cache_lock);
+  lock_release (&cache_lock);
+}
+
+/* Asks for SECTOR to be brought into the cache in the
+   background, because it is expected to be read soon.
+   Returns without waiting for the disk. */
+void
+cache_read_ahead (disk_sector_t sector)
+{
+  lock_acquire (&read_ahead_lock);
+  if (read_ahead_cnt < READ_AHEAD_MAX)
+    {
+      size_t tail = (read_ahead_head + read_ahead_cnt) % READ_AHEAD_MAX;
+      read_ahead_queue[tail] = sector;
+      read_ahead_cnt++;
+      cond_signal (&read_ahead_ready, &read_ahead_lock);
+    }
+  lock_release (&read_ahead_lock);
+}
+
+/* Reads queued sectors into the cache, one at a time, for as
+   long as the system runs. */
+static void
+read_ahead_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      disk_sector_t sector;
+
+      lock_acquire (&read_ahead_lock);
+      while (read_ahead_cnt == 0)
+        cond_wait (&read_ahead_ready, &read_ahead_lock);
+      sector = read_ahead_queue[read_ahead_head];
+      read_ahead_head = (read_ahead_head + 1) % READ_AHEAD_MAX;
+      read_ahead_cnt--;
+      lock_release (&read_ahead_lock);
+
+      /* Does nothing but pin and unpin the entry if the sector
+         is already cached. */
+      cache_put (cache_get (sector, true), false, false);
+    }
+}
+
+/* Writes all dirty sectors in the cache back to disk, except
+   logged and delayed ones. */
+void
+cache_flush (void)
+{
+  flush_entries (0);
+}
+
+/* Writes SECTOR back to disk if it is cached, dirty and neither
+   logged nor delayed. */
+void
+cache_flush_sector (disk_sector_t sector)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  e = cache_find (sector);
+  if (e == NULL)
+    {
+      lock_release (&cache_lock);
+      return;
+    }
+  e->pin_cnt++;
+  lock_release (&cache_lock);
+
+  lock_acquire (&e->lock);
+  if (e->dirty && !e->logged && !e->delayed)
+    {
+      disk_write (filesys_disk, e->sector, e->data);
+      e->dirty = false;
+    }
+  cache_put (e, false, false);
+}
+
+/* Writes back every sector that has been dirty for at least
+   MIN_AGE timer ticks, except logged and delayed ones. */
+static void
+flush_entries (int64_t min_age)
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &cache[i];
+
+      lock_acquire (&cache_lock);
+      if (!e->in_use)
+        {
+          lock_release (&cache_lock);
+          continue;
+        }
+      e->pin_cnt++;
+      lock_release (&cache_lock);
+
+      lock_acquire (&e->lock);
+      if (e->dirty && !e->logged && !e->delayed
+          && timer_elapsed (e->dirty_time) >= min_age)
+        {
+          disk_write (filesys_disk, e->sector, e->data);
+          e->dirty = false;
+        }
+      cache_put (e, false, false);
+    }
+}
+
+/* Periodically writes back sectors that have been dirty for
+   longer than cache_flush_age. */
+static void
+write_behind_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (FLUSH_PERIOD);
+      flush_entries (cache_flush_age * TIMER_FREQ / 1000);
+    }
+}
+
+/* Returns the cache entry at the clock hand and advances the
+   hand. */
+static struct cache_entry *
+clock_advance (void)
+{
+  struct cache_entry *e = &cache[clock_hand];
+  clock_hand = (clock_hand + 1) % CACHE_SIZE;
+  return e;
+}
+
+/* Chooses an unpinned entry to hold a new sector, using the
+   clock algorithm.  Logged and delayed entries are treated as
+   pinned.  Returns a null pointer if every entry is pinned.
+   A clean victim is freed for reuse.  A dirty one is returned
+   still holding its sector, and the caller must write it back
+   with write_back() and then choose again.
+   The caller must hold cache_lock. */
+static struct cache_entry *
+evict (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  /* Two sweeps are enough to clear every accessed bit. */
+  for (i = 0; i < 2 * CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = clock_advance ();
+      if (!e->in_use)
+        return e;
+      /* An unpinned entry's lock is free, so its logged and
+         delayed flags can be read without it. */
+      if (e->pin_cnt > 0 || e->logged || e->delayed)
+        continue;
+      if (e->accessed)
+        {
+          e->accessed = false;
+          continue;
+        }
+
+      if (!e->dirty)
+        e->in_use = false;
+      return e;
+    }
+  return NULL;
+}
+
+/* Writes dirty entry E back to disk, without holding cache_lock
+   while the disk works, so that other threads can keep using the
+   cache.  E is pinned meanwhile and keeps its sector, so a thread
+   that wants that sector finds it in the cache instead of reading
+   the old contents from disk.  The caller must hold cache_lock,
+   which is released and reacquired. */
+static void
+write_back (struct cache_entry *e)
+{
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  e->pin_cnt++;
+  lock_release (&cache_lock);
+
+  lock_acquire (&e->lock);
+  if (e->dirty && !e->logged && !e->delayed)
+    {
+      disk_write (filesys_disk, e->sector, e->data);
+      e->dirty = false;
+    }
+  lock_release (&e->lock);
+
+  lock_acquire (&cache_lock);
+  if (--e->pin_cnt == 0)
+    cond_broadcast (&entry_unpinned, &cache_lock);
+}
+
+/* Returns the entry that holds sector SECTOR, or a null pointer
+   if SECTOR is not cached.  The caller must hold cache_lock. */
+static struct cache_entry *
+cache_find (disk_sector_t sector)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (cache[i].in_use && cache[i].sector == sector)
+      return &cache[i];
+  return NULL;
+}
+
+/* Returns the entry for sector SECTOR, pinned and with its lock
+   held, bringing the sector into the cache if necessary.
+   If LOAD is false, the caller is about to overwrite the whole
+   sector, so a newly cached sector is not read from disk. */
+static struct cache_entry *
+cache_get (disk_sector_t sector, bool load)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  for (;;)
+    {
+      /* Check whether the sector is already cached. */
+      e = cache_find (sector);
+      if (e != NULL)
+        {
+          e->pin_cnt++;
+          e->accessed = true;
+          lock_release (&cache_lock);
+
+          lock_acquire (&e->lock);
+          return e;
+        }
+
+      /* Make room for it.  If everything is pinned, wait for an
+         entry to be released.  If the victim is dirty, write it
+         back first.  Either way, look again, since the sector
+         may have been brought in by someone else meanwhile.
+         Logged and delayed entries are limited (see
+         CACHE_LOGGED_MAX), so they never fill the cache by
+         themselves. */
+      e = evict ();
+      if (e == NULL)
+        cond_wait (&entry_unpinned, &cache_lock);
+      else if (e->in_use)
+        write_back (e);
+      else
+        break;
+    }
+
+  e->sector = sector;
+  e->in_use = true;
+  e->accessed = true;
+  e->logged = false;
+  e->delayed = false;
+  e->pin_cnt = 1;
+
+  /* Nobody else can hold the lock of an unpinned entry, so this
+     does not block.  Threads that find the new sector before it
+     is read in wait on the lock until it is. */
+  lock_acquire (&e->lock);
+  lock_release (&cache_lock);
+
+  if (load)
+    disk_read (filesys_disk, sector, e->data);
+  e->dirty = false;
+  return e;
+}
+
+/* Releases entry E, obtained from cache_get().  Marks it dirty
+   if DIRTY is true, and logged if LOGGED is true. */
+static void
+cache_put (struct cache_entry *e, bool dirty, bool logged)
+{
+  bool newly_logged = logged && !e->logged;
+
+  if (dirty && !e->dirty)
+    {
+      e->dirty = true;
+      e->dirty_time = timer_ticks ();
+    }
+  if (logged)
+    e->logged = true;
+  lock_release (&e->lock);
+
+  lock_acquire (&cache_lock);
+  if (newly_logged)
+    logged_cnt++;
+  ASSERT (e->pin_cnt > 0);
+  if (--e->pin_cnt == 0)
+    cond_broadcast (&entry_unpinned, &cache_lock);
+  lock_release (&cache_lock);
+}
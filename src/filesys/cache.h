@@ -0,0 +1,48 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "devices/disk.h"
+
+/* Number of sectors held in the buffer cache. */
+#define CACHE_SIZE 64
+
+/* Logged and delayed sectors cannot be evicted.  The journal
+   keeps at most CACHE_LOGGED_MAX sectors logged, and the inode
+   layer at most CACHE_DELAYED_MAX delayed, so that a quarter of
+   the cache is always left for everything else. */
+#define CACHE_LOGGED_MAX (CACHE_SIZE / 2)
+#define CACHE_DELAYED_MAX (CACHE_SIZE / 4)
+
+/* Default for cache_flush_age, in milliseconds. */
+#define CACHE_FLUSH_AGE_DEFAULT 2000
+
+/* Dirty sectors are written back once they have been dirty for
+   this many milliseconds.  Set by kernel command-line option
+   "-flush-age=MS". */
+extern int64_t cache_flush_age;
+
+void cache_init (void);
+void cache_done (void);
+
+void cache_read (disk_sector_t, void *);
+void cache_read_at (disk_sector_t, void *, off_t size, off_t offset);
+void cache_write (disk_sector_t, const void *);
+void cache_write_at (disk_sector_t, const void *, off_t size, off_t offset);
+bool cache_write_logged_at (disk_sector_t, const void *,
+                            off_t size, off_t offset);
+void cache_write_delayed_at (disk_sector_t, const void *,
+                             off_t size, off_t offset);
+void cache_assign (disk_sector_t temp, disk_sector_t);
+void cache_discard (disk_sector_t temp);
+void cache_read_ahead (disk_sector_t);
+void cache_flush (void);
+void cache_flush_sector (disk_sector_t);
+size_t cache_logged_cnt (void);
+size_t cache_logged (disk_sector_t[], size_t max);
+void cache_unlog (void);
+
+#endif /* filesys/cache.h */
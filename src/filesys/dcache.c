@@ -0,0 +1,188 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* The dentry cache remembers the results of recent directory
+   lookups, so that opening the same name again does not have to
+   search the directory.  Each entry maps a name within a
+   directory, identified by the sector of the directory's inode,
+   to the sector of the named file's inode.  A negative entry,
+   whose inode sector is 0, records that the directory does not
+   contain the name.  Sector 0 holds the free map inode, so no
+   directory ever names it.
+
+   The directory layer keeps the cache up to date: dir_add() and
+   dir_remove() replace the entry for the name they change, while
+   holding the directory's lock.  dir_create() purges the entries
+   of a directory whose inode sector is being reused.
+
+   When the cache is full, the least recently used entry is
+   replaced. */
+
+/* A cached directory entry. */
+struct dentry
+  {
+    struct hash_elem hash_elem;         /* Element in dentries. */
+    struct list_elem lru_elem;          /* Element in lru_list. */
+    bool in_use;                        /* In dentries? */
+    disk_sector_t dir_sector;           /* Directory's inode sector. */
+    disk_sector_t inode_sector;         /* File's inode sector, or 0. */
+    char name[NAME_MAX + 1];            /* File name. */
+  };
+
+static struct dentry dcache[DCACHE_SIZE];
+
+/* Entries that are in use, hashed by directory and name. */
+static struct hash dentries;
+
+/* All entries, most recently used first.  Entries not in use are
+   at the back. */
+static struct list lru_list;
+
+/* Protects all of the above.  No other lock is ever acquired while
+   holding it. */
+static struct lock dcache_lock;
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+
+/* Initializes the dentry cache. */
+void
+dcache_init (void)
+{
+  size_t i;
+
+  lock_init (&dcache_lock);
+  hash_init (&dentries, dentry_hash, dentry_less, NULL);
+  list_init (&lru_list);
+  for (i = 0; i < DCACHE_SIZE; i++)
+    {
+      dcache[i].in_use = false;
+      list_push_back (&lru_list, &dcache[i].lru_elem);
+    }
+}
+
+/* Returns the entry for NAME in the directory whose inode is in
+   DIR_SECTOR, or a null pointer if there is none.  Marks it most
+   recently used.  The caller must hold dcache_lock. */
+static struct dentry *
+find (disk_sector_t dir_sector, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+  struct dentry *d;
+
+  ASSERT (lock_held_by_current_thread (&dcache_lock));
+
+  key.dir_sector = dir_sector;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dentries, &key.hash_elem);
+  if (e == NULL)
+    return NULL;
+
+  d = hash_entry (e, struct dentry, hash_elem);
+  list_remove (&d->lru_elem);
+  list_push_front (&lru_list, &d->lru_elem);
+  return d;
+}
+
+/* Looks up NAME in the directory whose inode is in DIR_SECTOR.
+   Returns false if the cache does not know whether the directory
+   contains NAME.  Otherwise returns true and sets *INODE_SECTOR
+   to NAME's inode sector, or to 0 if the directory does not
+   contain NAME. */
+bool
+dcache_lookup (disk_sector_t dir_sector, const char *name,
+               disk_sector_t *inode_sector)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return false;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir_sector, name);
+  if (d != NULL)
+    *inode_sector = d->inode_sector;
+  lock_release (&dcache_lock);
+
+  return d != NULL;
+}
+
+/* Records that NAME in the directory whose inode is in
+   DIR_SECTOR names the inode in INODE_SECTOR, or that the
+   directory does not contain NAME if INODE_SECTOR is 0. */
+void
+dcache_insert (disk_sector_t dir_sector, const char *name,
+               disk_sector_t inode_sector)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  d = find (dir_sector, name);
+  if (d == NULL)
+    {
+      /* Replace the least recently used entry. */
+      d = list_entry (list_back (&lru_list), struct dentry, lru_elem);
+      if (d->in_use)
+        hash_delete (&dentries, &d->hash_elem);
+      d->in_use = true;
+      d->dir_sector = dir_sector;
+      strlcpy (d->name, name, sizeof d->name);
+      hash_insert (&dentries, &d->hash_elem);
+      list_remove (&d->lru_elem);
+      list_push_front (&lru_list, &d->lru_elem);
+    }
+  d->inode_sector = inode_sector;
+  lock_release (&dcache_lock);
+}
+
+/* Drops every entry for the directory whose inode is in
+   DIR_SECTOR. */
+void
+dcache_purge (disk_sector_t dir_sector)
+{
+  size_t i;
+
+  lock_acquire (&dcache_lock);
+  for (i = 0; i < DCACHE_SIZE; i++)
+    {
+      struct dentry *d = &dcache[i];
+      if (d->in_use && d->dir_sector == dir_sector)
+        {
+          hash_delete (&dentries, &d->hash_elem);
+          d->in_use = false;
+          list_remove (&d->lru_elem);
+          list_push_back (&lru_list, &d->lru_elem);
+        }
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Returns the hash value for the entry in E. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_string (d->name) ^ hash_int (d->dir_sector);
+}
+
+/* Returns true if entry A precedes entry B. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+  if (a->dir_sector != b->dir_sector)
+    return a->dir_sector < b->dir_sector;
+  return strcmp (a->name, b->name) < 0;
+}
@@ -0,0 +1,17 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Number of directory entries held in the dentry cache. */
+#define DCACHE_SIZE 256
+
+void dcache_init (void);
+bool dcache_lookup (disk_sector_t dir_sector, const char *name,
+                    disk_sector_t *inode_sector);
+void dcache_insert (disk_sector_t dir_sector, const char *name,
+                    disk_sector_t inode_sector);
+void dcache_purge (disk_sector_t dir_sector);
+
+#endif /* filesys/dcache.h */
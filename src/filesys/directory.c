@@ -1,7 +1,11 @@
 #include "filesys/directory.h"
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include <round.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -18,24 +22,112 @@ struct dir_entry
   {
     disk_sector_t inode_sector;         /* Sector number of header. */
     char name[NAME_MAX + 1];            /* Null terminated file name. */
-    bool in_use;                        /* In use or free? */
+    bool in_use : 1;                    /* In use or free? */
+    bool is_dir : 1;                    /* Is the file a directory? */
+  };
+
+/* A directory is kept in one of two formats.
+
+   A directory that fits in one sector is just an array of
+   struct dir_entry, searched linearly.
+
+   When it outgrows that sector, it is converted to a hashed
+   directory.  Its first block then begins with a struct
+   dir_header, followed by the entries that the directory had
+   when it was converted.  It is followed by bucket_cnt bucket
+   blocks, one per bucket.  An entry whose name hashes to bucket B
+   is kept in the first block, in bucket block B or in one of the
+   overflow blocks chained to it through NEXT.  Overflow blocks
+   are added at the end of the file.  Bucket blocks that have
+   never been written are holes in the file, so they read as
+   empty.  Lookup, add and remove therefore read only the first
+   block and one block for each link in the bucket's chain. */
+
+/* Number of directory entries in a block of a hashed
+   directory. */
+#define BLOCK_ENTRY_CNT ((DISK_SECTOR_SIZE - sizeof (uint32_t)) \
+                         / sizeof (struct dir_entry))
+
+/* A bucket or overflow block of a hashed directory. */
+struct dir_block
+  {
+    uint32_t next;                      /* Next block in chain, or 0. */
+    struct dir_entry entries[BLOCK_ENTRY_CNT];
+    uint8_t unused[DISK_SECTOR_SIZE - sizeof (uint32_t)
+                   - BLOCK_ENTRY_CNT * sizeof (struct dir_entry)];
+  };
+
+/* Number of entries in the first block of a hashed directory.
+   The header takes the place of NEXT and of the first entry, so
+   the entries end where they do in other blocks.  A linear
+   directory holds at most this many entries, so converting it
+   moves its entries only within its first sector. */
+#define HEAD_ENTRY_CNT (BLOCK_ENTRY_CNT - 1)
+
+/* Number of buckets in a newly hashed directory. */
+#define DIR_BUCKET_CNT 128
+
+/* Stored in MARKER.inode_sector to identify a hashed directory.
+   It is never a valid sector number. */
+#define DIR_HASH_MAGIC 0xd1a5ba5e
+
+/* Start of the first block of a hashed directory.  MARKER sits
+   where the first entry of a linear directory would be, and is
+   never in use, so it is skipped by code that does not know about
+   hashed directories.  Must be exactly as long as NEXT and one
+   entry of a struct dir_block. */
+struct dir_header
+  {
+    struct dir_entry marker;            /* Not in use. */
+    uint32_t bucket_cnt;                /* Number of buckets. */
   };
 
 /* Creates a directory with space for ENTRY_CNT entries in the
-   given SECTOR.  Returns true if successful, false on failure. */
+   given SECTOR, whose parent directory is in PARENT_SECTOR.  The
+   new directory starts out with entries "." and "..", for
+   itself and its parent.  ENTRY_CNT must leave room for them.
+   Returns true if successful, false on failure. */
 bool
-dir_create (disk_sector_t sector, size_t entry_cnt) 
+dir_create (disk_sector_t sector, disk_sector_t parent_sector,
+            size_t entry_cnt) 
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  struct dir_entry e[2];
+  struct inode *inode;
+  bool success;
+
+  ASSERT (entry_cnt >= 2);
+
+  /* Forget the entries of any earlier directory in SECTOR. */
+  dcache_purge (sector);
+  if (!inode_create (sector, entry_cnt * sizeof (struct dir_entry), true))
+    return false;
+
+  /* The directory is not linked into the tree yet, so nobody else
+     can be using it. */
+  memset (e, 0, sizeof e);
+  e[0].inode_sector = sector;
+  strlcpy (e[0].name, ".", sizeof e[0].name);
+  e[0].in_use = true;
+  e[0].is_dir = true;
+  e[1].inode_sector = parent_sector;
+  strlcpy (e[1].name, "..", sizeof e[1].name);
+  e[1].in_use = true;
+  e[1].is_dir = true;
+  inode = inode_open (sector);
+  success = (inode != NULL
+             && inode_write_at (inode, e, sizeof e, 0) == sizeof e);
+  inode_close (inode);
+  return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
-   it takes ownership.  Returns a null pointer on failure. */
+   it takes ownership.  Returns a null pointer on failure, or if
+   INODE is not a directory. */
 struct dir *
 dir_open (struct inode *inode) 
 {
   struct dir *dir = calloc (1, sizeof *dir);
-  if (inode != NULL && dir != NULL)
+  if (inode != NULL && dir != NULL && inode_is_dir (inode))
     {
       dir->inode = inode;
       dir->pos = 0;
@@ -83,21 +175,139 @@ dir_get_inode (struct dir *dir)
   return dir->inode;
 }
 
+/* Returns the number of buckets in DIR, or 0 if DIR is a linear
+   directory. */
+static size_t
+bucket_cnt (const struct dir *dir)
+{
+  struct dir_header h;
+
+  if (inode_read_at (dir->inode, &h, sizeof h, 0) == sizeof h
+      && !h.marker.in_use && h.marker.inode_sector == DIR_HASH_MAGIC)
+    return h.bucket_cnt;
+  return 0;
+}
+
+/* Returns the block of DIR that holds bucket NAME hashes to, out
+   of BUCKET_CNT buckets. */
+static size_t
+bucket_block (const char *name, size_t bucket_cnt)
+{
+  return 1 + hash_string (name) % bucket_cnt;
+}
+
+/* Returns the number of sectors in a directory SIZE bytes
+   long. */
+static size_t
+bytes_to_sectors (off_t size)
+{
+  return DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
+}
+
+/* Returns the byte offset of entry IDX in block BLOCK of a hashed
+   directory.  In block 0, the header takes the place of entry
+   0. */
+static off_t
+entry_ofs (size_t block, size_t idx)
+{
+  return (block * DISK_SECTOR_SIZE + offsetof (struct dir_block, entries)
+          + idx * sizeof (struct dir_entry));
+}
+
+/* Reads block BLOCK of hashed directory DIR into *B.  A block
+   past end of file is empty. */
+static void
+read_block (const struct dir *dir, size_t block, struct dir_block *b)
+{
+  off_t ofs = block * DISK_SECTOR_SIZE;
+  off_t size = inode_read_at (dir->inode, b, sizeof *b, ofs);
+  memset ((char *) b + size, 0, sizeof *b - size);
+}
+
+/* Searches the first block of hashed directory DIR, which has
+   BUCKET_CNT buckets, and the bucket that NAME hashes to.
+   Returns true if NAME is found, storing the entry into *EP if
+   EP is non-null and its byte offset into *OFSP if OFSP is
+   non-null.
+   Otherwise returns false.  In that case, if FREEP is non-null,
+   stores into *FREEP the offset of a free entry in those blocks,
+   or -1 if there is none, and stores into *LASTP the last block
+   in the bucket's chain. */
+static bool
+hashed_lookup (const struct dir *dir, size_t bucket_cnt, const char *name,
+               struct dir_entry *ep, off_t *ofsp,
+               off_t *freep, size_t *lastp)
+{
+  struct dir_block *b;
+  size_t block = 0;
+  size_t first = 1;
+  bool found = false;
+
+  if (freep != NULL)
+    *freep = -1;
+
+  b = malloc (sizeof *b);
+  if (b == NULL)
+    return false;
+  for (;;)
+    {
+      size_t i;
+
+      read_block (dir, block, b);
+      for (i = first; i < BLOCK_ENTRY_CNT; i++)
+        {
+          struct dir_entry *e = &b->entries[i];
+          if (e->in_use && !strcmp (name, e->name))
+            {
+              if (ep != NULL)
+                *ep = *e;
+              if (ofsp != NULL)
+                *ofsp = entry_ofs (block, i);
+              found = true;
+              goto done;
+            }
+          if (!e->in_use && freep != NULL && *freep == -1)
+            *freep = entry_ofs (block, i);
+        }
+      if (block == 0)
+        {
+          block = bucket_block (name, bucket_cnt);
+          first = 0;
+          continue;
+        }
+      if (b->next == 0)
+        break;
+      block = b->next;
+    }
+  if (lastp != NULL)
+    *lastp = block;
+
+ done:
+  free (b);
+  return found;
+}
+
 /* Searches DIR for a file with the given NAME.
    If successful, returns true, sets *EP to the directory entry
    if EP is non-null, and sets *OFSP to the byte offset of the
    directory entry if OFSP is non-null.
-   otherwise, returns false and ignores EP and OFSP. */
+   otherwise, returns false and ignores EP and OFSP.
+   The caller must hold DIR's inode lock. */
 static bool
 lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp) 
 {
   struct dir_entry e;
   size_t ofs;
+  size_t buckets;
   
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  buckets = bucket_cnt (dir);
+  if (buckets != 0)
+    return hashed_lookup (dir, buckets, name, ep, ofsp, NULL, NULL);
+
   for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
        ofs += sizeof e) 
     if (e.in_use && !strcmp (name, e.name)) 
@@ -111,6 +321,66 @@ lookup (const struct dir *dir, const char *name,
   return false;
 }
 
+/* Finds room for a new entry named NAME in hashed directory DIR,
+   which has BUCKET_CNT buckets and does not contain NAME.
+   Returns the byte offset of the free entry, chaining a new
+   overflow block to the bucket if it is full, or -1 if memory
+   allocation fails. */
+static off_t
+hashed_slot (struct dir *dir, size_t bucket_cnt, const char *name)
+{
+  off_t ofs;
+  size_t last;
+  uint32_t next;
+
+  if (hashed_lookup (dir, bucket_cnt, name, NULL, NULL, &ofs, &last))
+    return -1;
+  if (ofs != -1)
+    return ofs;
+
+  /* The bucket is full.  Chain a new block to it, past both the
+     bucket blocks and the end of file.  The block is a hole, so it
+     reads as empty until the entry is written. */
+  next = bytes_to_sectors (inode_length (dir->inode));
+  if (next < 1 + bucket_cnt)
+    next = 1 + bucket_cnt;
+  if (inode_write_at (dir->inode, &next, sizeof next,
+                      last * DISK_SECTOR_SIZE) != sizeof next)
+    return -1;
+  return entry_ofs (next, 0);
+}
+
+/* Converts linear directory DIR to a hashed directory.
+   Returns true if successful, false on failure.
+   The entries stay in DIR's first block, behind the header, so
+   the conversion rewrites only that block, all at once.  If it
+   fails, DIR is left as it was. */
+static bool
+convert_to_hashed (struct dir *dir)
+{
+  off_t length = inode_length (dir->inode);
+  struct dir_header *h;
+  bool success;
+
+  ASSERT (sizeof *h == entry_ofs (0, 1));
+  ASSERT (length <= (off_t) (HEAD_ENTRY_CNT * sizeof (struct dir_entry)));
+
+  h = calloc (1, DISK_SECTOR_SIZE);
+  if (h == NULL)
+    return false;
+  success = inode_read_at (dir->inode, h + 1, length, 0) == length;
+  if (success)
+    {
+      h->marker.inode_sector = DIR_HASH_MAGIC;
+      h->marker.in_use = false;
+      h->bucket_cnt = DIR_BUCKET_CNT;
+      success = (inode_write_at (dir->inode, h, DISK_SECTOR_SIZE, 0)
+                 == DISK_SECTOR_SIZE);
+    }
+  free (h);
+  return success;
+}
+
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
@@ -119,30 +389,42 @@ bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
+  disk_sector_t dir_sector;
+  disk_sector_t inode_sector;
   struct dir_entry e;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
-  else
-    *inode = NULL;
+  dir_sector = inode_get_inumber (dir->inode);
+  inode_lock (dir->inode);
+  if (inode_is_removed (dir->inode))
+    inode_sector = 0;
+  else if (!dcache_lookup (dir_sector, name, &inode_sector))
+    {
+      inode_sector = lookup (dir, name, &e, NULL) ? e.inode_sector : 0;
+      dcache_insert (dir_sector, name, inode_sector);
+    }
+  *inode = inode_sector != 0 ? inode_open (inode_sector) : NULL;
+  inode_unlock (dir->inode);
 
   return *inode != NULL;
 }
 
 /* Adds a file named NAME to DIR, which must not already contain a
    file by that name.  The file's inode is in sector
-   INODE_SECTOR.
+   INODE_SECTOR, and IS_DIR tells whether it is a directory.
    Returns true if successful, false on failure.
-   Fails if NAME is invalid (i.e. too long) or a disk or memory
-   error occurs. */
+   Fails if NAME is invalid (i.e. too long), if DIR has been
+   removed, or if a disk or memory error occurs. */
 bool
-dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) 
+dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector,
+         bool is_dir) 
 {
   struct dir_entry e;
   off_t ofs;
+  size_t buckets;
+  disk_sector_t cached;
   bool success = false;
   
   ASSERT (dir != NULL);
@@ -152,8 +434,17 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
+  inode_lock (dir->inode);
+  if (inode_is_removed (dir->inode))
+    goto done;
+
   /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
+  if (dcache_lookup (inode_get_inumber (dir->inode), name, &cached))
+    {
+      if (cached != 0)
+        goto done;
+    }
+  else if (lookup (dir, name, NULL, NULL))
     goto done;
 
   /* Set OFS to offset of free slot.
@@ -163,35 +454,146 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector)
      inode_read_at() will only return a short read at end of file.
      Otherwise, we'd need to verify that we didn't get a short
      read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
+  buckets = bucket_cnt (dir);
+  if (buckets == 0)
+    {
+      for (ofs = 0;
+           inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+           ofs += sizeof e) 
+        if (!e.in_use)
+          break;
+
+      /* A linear directory that would outgrow the room after the
+         header of a hashed directory is converted to one
+         instead. */
+      if (ofs >= (off_t) (HEAD_ENTRY_CNT * sizeof e))
+        {
+          if (!convert_to_hashed (dir))
+            goto done;
+          buckets = DIR_BUCKET_CNT;
+        }
+    }
+  if (buckets != 0)
+    {
+      ofs = hashed_slot (dir, buckets, name);
+      if (ofs == -1)
+        goto done;
+    }
 
   /* Write slot. */
   e.in_use = true;
+  e.is_dir = is_dir;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  if (success)
+    dcache_insert (inode_get_inumber (dir->inode), name, inode_sector);
 
  done:
+  inode_unlock (dir->inode);
   return success;
 }
 
+/* Reads the entries of a directory in order, a sector at a
+   time.  Entries never cross a sector boundary. */
+struct entry_reader
+  {
+    struct dir *dir;                    /* Directory being read. */
+    bool hashed;                        /* Is DIR a hashed directory? */
+    off_t ofs;                          /* Offset of DATA in DIR, or -1. */
+    off_t size;                         /* Number of bytes in DATA. */
+    uint8_t data[DISK_SECTOR_SIZE];     /* Sector of DIR. */
+  };
+
+/* Initializes R to read DIR's entries, starting from DIR's
+   current position. */
+static void
+reader_init (struct entry_reader *r, struct dir *dir)
+{
+  r->dir = dir;
+  r->hashed = bucket_cnt (dir) != 0;
+  r->ofs = -1;
+  r->size = 0;
+}
+
+/* Reads the next entry of R's directory after its current
+   position, skipping "." and "..", and stores it in *EP.
+   Returns true if successful, false if the directory contains no
+   more entries.  The caller must hold the directory's inode
+   lock. */
+static bool
+next_entry (struct entry_reader *r, struct dir_entry *ep)
+{
+  struct dir *dir = r->dir;
+
+  if (r->hashed && dir->pos < entry_ofs (0, 1))
+    dir->pos = entry_ofs (0, 1);
+  for (;;) 
+    {
+      off_t ofs = ROUND_DOWN (dir->pos, DISK_SECTOR_SIZE);
+
+      if (ofs != r->ofs)
+        {
+          r->size = inode_read_at (dir->inode, r->data, DISK_SECTOR_SIZE,
+                                   ofs);
+          r->ofs = ofs;
+        }
+      if (dir->pos - ofs + (off_t) sizeof *ep > r->size)
+        return false;
+      memcpy (ep, r->data + (dir->pos - ofs), sizeof *ep);
+      dir->pos += sizeof *ep;
+
+      /* Skip to the first entry of the next block. */
+      if (r->hashed && dir->pos % DISK_SECTOR_SIZE
+                       == entry_ofs (0, BLOCK_ENTRY_CNT))
+        dir->pos = entry_ofs (dir->pos / DISK_SECTOR_SIZE + 1, 0);
+
+      if (ep->in_use && strcmp (ep->name, ".") && strcmp (ep->name, ".."))
+        return true;
+    }
+}
+
+/* Returns true if directory INODE contains no entries other
+   than "." and "..".  The caller must hold INODE's lock. */
+static bool
+is_empty (struct inode *inode)
+{
+  struct entry_reader r;
+  struct dir dir;
+  struct dir_entry e;
+
+  dir.inode = inode;
+  dir.pos = 0;
+  reader_init (&r, &dir);
+  return !next_entry (&r, &e);
+}
+
 /* Removes any entry for NAME in DIR.
-   Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   Returns true if successful, false on failure, which occurs
+   only if there is no file with the given NAME, if NAME is "."
+   or "..", or if NAME is a directory that is not empty or is
+   the root directory.
+
+   DIR's lock is held while the lock of a directory being removed
+   is acquired, so that nothing can be added to it between
+   checking that it is empty and marking it removed. */
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
   struct dir_entry e;
   struct inode *inode = NULL;
+  bool locked = false;
   bool success = false;
   off_t ofs;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  if (!strcmp (name, ".") || !strcmp (name, ".."))
+    return false;
+
+  inode_lock (dir->inode);
+
   /* Find directory entry. */
   if (!lookup (dir, name, &e, &ofs))
     goto done;
@@ -201,6 +603,18 @@ dir_remove (struct dir *dir, const char *name)
   if (inode == NULL)
     goto done;
 
+  /* A directory must be empty, and stays locked until it is
+     marked removed. */
+  if (inode_is_dir (inode))
+    {
+      if (e.inode_sector == ROOT_DIR_SECTOR)
+        goto done;
+      inode_lock (inode);
+      locked = true;
+      if (!is_empty (inode))
+        goto done;
+    }
+
   /* Erase directory entry. */
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
@@ -208,29 +622,74 @@ dir_remove (struct dir *dir, const char *name)
 
   /* Remove inode. */
   inode_remove (inode);
+  if (locked)
+    dcache_purge (e.inode_sector);
+  dcache_insert (inode_get_inumber (dir->inode), name, 0);
   success = true;
 
  done:
+  if (locked)
+    inode_unlock (inode);
+  inode_unlock (dir->inode);
   inode_close (inode);
   return success;
 }
 
 /* Reads the next directory entry in DIR and stores the name in
    NAME.  Returns true if successful, false if the directory
-   contains no more entries. */
+   contains no more entries.  The "." and ".." entries are not
+   returned. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
+  struct entry_reader r;
+  struct dir_entry e;
+  bool success;
+
+  inode_lock (dir->inode);
+  reader_init (&r, dir);
+  success = next_entry (&r, &e);
+  if (success)
+    strlcpy (name, e.name, NAME_MAX + 1);
+  inode_unlock (dir->inode);
+  return success;
+}
+
+/* Reads up to CNT of the directory entries in DIR that follow
+   its current position into ENTRIES, as dir_readdir() would,
+   but reading each sector of DIR only once.  Returns the number
+   of entries read, which is 0 at end of directory. */
+size_t
+dir_getdents (struct dir *dir, struct dirent *entries, size_t cnt)
+{
+  struct entry_reader r;
   struct dir_entry e;
+  size_t i = 0;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
+  inode_lock (dir->inode);
+  reader_init (&r, dir);
+  for (; i < cnt && next_entry (&r, &e); i++)
     {
-      dir->pos += sizeof e;
-      if (e.in_use)
-        {
-          strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
-        } 
+      entries[i].d_ino = e.inode_sector;
+      entries[i].d_is_dir = e.is_dir;
+      strlcpy (entries[i].d_name, e.name, sizeof entries[i].d_name);
     }
-  return false;
+  inode_unlock (dir->inode);
+  return i;
+}
+
+/* Sets the position in DIR at which dir_readdir() continues to
+   POS, which must have been returned by dir_tell(). */
+void
+dir_seek (struct dir *dir, off_t pos)
+{
+  ASSERT (pos >= 0);
+  dir->pos = pos;
+}
+
+/* Returns the position in DIR at which dir_readdir() continues. */
+off_t
+dir_tell (const struct dir *dir)
+{
+  return dir->pos;
 }
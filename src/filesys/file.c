@@ -2,6 +2,7 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "devices/disk.h"
 
 /* An open file. */
 struct file 
@@ -9,11 +10,6 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
-
-    /* Added in lab 6 */
-    int readers_count;          /* Keep check of the amount current readers. */
-    struct lock rw_mutex;       /* Locks the other function from running. */
-    struct lock readers;        /* Controll changes to readers_count. */
   };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -28,12 +24,6 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
-
-      /* Initialize for readers-writers */
-      file->readers_count = 0;
-      lock_init(&(file->readers));
-      lock_init(&(file->rw_mutex)); // Mutex =  Mutually exclusive flag
-
       return file;
     }
   else
@@ -79,31 +69,8 @@ file_get_inode (struct file *file)
 off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
-  lock_acquire(&(file->readers));   // Protect readers count
-
-  file->readers_count++;  
-   
-  if (file->readers_count == 1) // If this is the first reader
-  {
-    lock_acquire(&(file->rw_mutex));
-  }
-
-  lock_release(&(file->readers));
-
   off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_read;
-
-  lock_acquire(&(file->readers));   // Protect readers count
-
-  file->readers_count--;
-  
-  /* As soon as the counter reaches 0, give up access to the file to let write run. */
-  if (file->readers_count == 0)
-  {
-    lock_release(&(file->rw_mutex));
-  }
-  lock_release(&(file->readers));
-
   return bytes_read;
 }
 
@@ -128,13 +95,8 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
 {
-  lock_acquire(&(file->rw_mutex));
-
   off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_written;
-
-  lock_release(&(file->rw_mutex));
-
   return bytes_written;
 }
 
@@ -152,6 +114,97 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads from FILE into the IOVCNT buffers in IOV, in order,
+   starting at the file's current position.  Returns the number
+   of bytes actually read, which may be less than the total size
+   of the buffers if end of file is reached.  Advances FILE's
+   position by the number of bytes read. */
+off_t
+file_readv (struct file *file, const struct iovec *iov, int iovcnt)
+{
+  off_t bytes_read = inode_readv_at (file->inode, iov, iovcnt, file->pos);
+  file->pos += bytes_read;
+  return bytes_read;
+}
+
+/* Writes the IOVCNT buffers in IOV into FILE, in order, starting
+   at the file's current position, as a single write.  Returns
+   the number of bytes actually written, which may be less than
+   their total size if the disk becomes full.  Advances FILE's
+   position by the number of bytes written. */
+off_t
+file_writev (struct file *file, const struct iovec *iov, int iovcnt)
+{
+  off_t bytes_written = inode_writev_at (file->inode, iov, iovcnt,
+                                         file->pos);
+  file->pos += bytes_written;
+  return bytes_written;
+}
+
+/* Copies up to SIZE bytes from IN, starting at its current
+   position, into OUT at its current position, without passing
+   through user memory.  Returns the number of bytes actually
+   copied, which may be less than SIZE if end of IN is reached or
+   the disk becomes full.  Advances both positions by the number
+   of bytes copied.
+
+   The data moves a sector at a time from IN's cache entry into
+   OUT's, through a single sector on the stack.  Each piece ends
+   at a sector boundary of OUT, so that all but the first and
+   last fill a whole sector, which the cache then does not have
+   to read in first. */
+off_t
+file_copy (struct file *out, struct file *in, off_t size)
+{
+  uint8_t sector[DISK_SECTOR_SIZE];
+  off_t bytes_copied = 0;
+
+  ASSERT (out != NULL);
+  ASSERT (in != NULL);
+
+  while (size > 0)
+    {
+      off_t sector_left = DISK_SECTOR_SIZE - out->pos % DISK_SECTOR_SIZE;
+      off_t chunk_size = size < sector_left ? size : sector_left;
+      off_t bytes_read, bytes_written;
+
+      bytes_read = inode_read_at (in->inode, sector, chunk_size, in->pos);
+      if (bytes_read == 0)
+        break;
+      bytes_written = inode_write_at (out->inode, sector, bytes_read,
+                                      out->pos);
+      in->pos += bytes_written;
+      out->pos += bytes_written;
+      bytes_copied += bytes_written;
+      size -= bytes_written;
+      if (bytes_written < bytes_read)
+        break;
+    }
+
+  return bytes_copied;
+}
+
+/* Allocates disk space for the SIZE bytes of FILE starting at
+   offset FILE_OFS, as inode_allocate() does.  If KEEP_SIZE is
+   false, FILE is extended to cover them.  Returns true if
+   successful, false if the disk becomes full. */
+bool
+file_allocate (struct file *file, off_t file_ofs, off_t size,
+               bool keep_size)
+{
+  ASSERT (file != NULL);
+  return inode_allocate (file->inode, file_ofs, size, keep_size);
+}
+
+/* Writes FILE's data back to disk, so that it survives a
+   crash. */
+void
+file_sync (struct file *file)
+{
+  ASSERT (file != NULL);
+  inode_flush (file->inode);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -6,6 +6,7 @@
 #include <stdio.h>
 
 struct inode;
+struct iovec;
 
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
@@ -18,6 +19,12 @@ off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+off_t file_readv (struct file *, const struct iovec *, int iovcnt);
+off_t file_writev (struct file *, const struct iovec *, int iovcnt);
+off_t file_copy (struct file *out, struct file *in, off_t size);
+bool file_allocate (struct file *, off_t offset, off_t size,
+                    bool keep_size);
+void file_sync (struct file *);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
@@ -2,39 +2,84 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/journal.h"
 #include "devices/disk.h"
+#include "threads/thread.h"
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
 
 static void do_format (void);
 
-struct lock remove_create;
+/* Locking.
 
-struct dir_lock;
+   There is no lock over the whole file system.  Operations on
+   unrelated files and directories proceed in parallel.  When a
+   thread needs more than one of the following locks, it acquires
+   them in this order:
+
+     0. A journal handle (journal_begin()).  Starting one may wait
+        for a commit, and a commit waits for every open handle to
+        end, so a thread starts its outermost handle before it
+        takes any of the locks below.  For the same reason, an
+        inode closed for the last time inside a handle has its
+        blocks freed only after the handle ends, by
+        inode_free_removed().
+
+     1. A directory's inode lock (inode_lock()), held by the
+        directory layer for each lookup, add, remove or readdir.
+        Removing a directory also locks the directory being
+        removed, after its parent.  Path walks hold only one
+        directory's lock at a time.
+
+     2. open_inodes_lock in inode.c, which guards the table of
+        open inodes and their open counts.  It is not held while
+        an inode is read from disk (see inode_open()).
+
+     3. An inode's rwlock, held for reading by inode_read_at()
+        and for writing by inode_write_at().  Writers hold it
+        while they allocate sectors and change the length.
+
+     4. free_map_lock in free-map.c.
+
+     5. journal_lock in journal.c.
+
+     6. cache_lock in cache.c, then the lock of a cache entry.
+
+   dcache_lock in dcache.c is acquired after a directory's inode
+   lock, and nothing else is acquired while holding it.
+   delayed_lock in inode.c is likewise acquired last.
+
+   The free map writes itself to disk while holding
+   free_map_lock, which takes the free map inode's rwlock after
+   it.  Only free-map.c uses that inode, always under
+   free_map_lock, so its rwlock is never taken in any other
+   order. */
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
 void
 filesys_init (bool format) 
 {
-  lock_init(&remove_create);
-  //lock_init()
-
   filesys_disk = disk_get (0, 1);
   if (filesys_disk == NULL)
     PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
+  cache_init ();
+  dcache_init ();
   inode_init ();
   free_map_init ();
 
   if (format) 
     do_format ();
 
+  journal_init ();
   free_map_open ();
 }
 
@@ -43,9 +88,118 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  inode_sync ();
   free_map_close ();
+  journal_done ();
+  cache_done ();
 }
 
+/* Writes all data buffered in memory back to disk. */
+void
+filesys_sync (void)
+{
+  inode_sync ();
+  journal_commit ();
+  cache_flush ();
+}
+
+/* Extracts a file name part from *SRCP into PART, and updates
+   *SRCP so that the next call will return the next file name
+   part.  Returns 1 if successful, 0 at end of string, -1 for a
+   too-long file name part. */
+static int
+next_part (char part[NAME_MAX + 1], const char **srcp)
+{
+  const char *src = *srcp;
+  char *dst = part;
+
+  /* Skip leading slashes.  If it's all slashes, we're done. */
+  while (*src == '/')
+    src++;
+  if (*src == '\0')
+    return 0;
+
+  /* Copy up to NAME_MAX characters from SRC to DST.  Add null
+     terminator. */
+  while (*src != '/' && *src != '\0')
+    {
+      if (dst < part + NAME_MAX)
+        *dst++ = *src;
+      else
+        return -1;
+      src++;
+    }
+  *dst = '\0';
+
+  /* Advance source pointer. */
+  *srcp = src;
+  return 1;
+}
+
+/* Resolves PATH to the directory that contains its last
+   component, which is stored into NAME, and returns that
+   directory.  The caller must close it.  A PATH made up only of
+   slashes names the root directory, as "." within itself.
+   Returns a null pointer if PATH is empty or too long a name,
+   or if a component other than the last is not a directory.
+
+   An absolute PATH is walked from the root directory, and a
+   relative one from the working directory of the running
+   thread, so that a lookup in a deep tree does not walk down
+   from the root each time.  Each step goes through the dentry
+   cache. */
+static struct dir *
+resolve (const char *path, char name[NAME_MAX + 1])
+{
+  struct dir *cwd = thread_current ()->cwd;
+  struct dir *dir;
+  char next[NAME_MAX + 1];
+  int ok;
+
+  if (*path == '\0')
+    return NULL;
+  dir = *path == '/' || cwd == NULL ? dir_open_root () : dir_reopen (cwd);
+  if (dir == NULL)
+    return NULL;
+
+  ok = next_part (name, &path);
+  if (ok == 0)
+    strlcpy (name, ".", NAME_MAX + 1);
+  while (ok > 0)
+    {
+      struct inode *inode;
+
+      ok = next_part (next, &path);
+      if (ok <= 0)
+        break;
+
+      dir_lookup (dir, name, &inode);
+      dir_close (dir);
+      dir = dir_open (inode);
+      if (dir == NULL)
+        return NULL;
+      strlcpy (name, next, NAME_MAX + 1);
+    }
+  if (ok < 0)
+    {
+      dir_close (dir);
+      return NULL;
+    }
+  return dir;
+}
+
+/* Allocates a sector for a new inode in DIR and stores it into
+   *SECTORP.  It is placed as close after DIR's own inode as
+   possible, so that a directory and the files in it are near
+   each other on disk.  Returns true if successful, false if the
+   disk is full. */
+static bool
+allocate_inode (struct dir *dir, disk_sector_t *sectorp)
+{
+  return free_map_allocate_near (inode_get_inumber (dir_get_inode (dir)),
+                                 1, sectorp);
+}
+
 /* Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
@@ -53,24 +207,58 @@ filesys_done (void)
 bool
 filesys_create (const char *name, off_t initial_size) 
 {
-  lock_acquire(&remove_create);
-
   disk_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+  disk_sector_t cached;
+  char last[NAME_MAX + 1];
+  struct dir *dir;
+  bool success;
+
+  journal_begin ();
+  dir = resolve (name, last);
+  success = (dir != NULL
+             && !(dcache_lookup (inode_get_inumber (dir_get_inode (dir)),
+                                 last, &cached) && cached != 0)
+             && allocate_inode (dir, &inode_sector)
+             && inode_create (inode_sector, initial_size, false)
+             && dir_add (dir, last, inode_sector, false));
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
+  journal_end ();
+  inode_free_removed ();
+
+  return success;
+}
 
-  lock_release(&remove_create);
+/* Creates a directory named NAME.
+   Returns true if successful, false otherwise.
+   Fails if a file named NAME already exists,
+   or if internal memory allocation fails. */
+bool
+filesys_mkdir (const char *name)
+{
+  disk_sector_t inode_sector = 0;
+  char last[NAME_MAX + 1];
+  struct dir *dir;
+  bool success;
+
+  journal_begin ();
+  dir = resolve (name, last);
+  success = (dir != NULL
+             && allocate_inode (dir, &inode_sector)
+             && dir_create (inode_sector,
+                            inode_get_inumber (dir_get_inode (dir)), 16)
+             && dir_add (dir, last, inode_sector, true));
+  if (!success && inode_sector != 0) 
+    free_map_release (inode_sector, 1);
+  dir_close (dir);
+  journal_end ();
+  inode_free_removed ();
 
   return success;
 }
 
-/* Opens the file with the given NAME.
+/* Opens the file or directory with the given NAME.
    Returns the new file if successful or a null pointer
    otherwise.
    Fails if no file named NAME exists,
@@ -78,48 +266,69 @@ filesys_create (const char *name, off_t initial_size)
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
+  char last[NAME_MAX + 1];
+  struct dir *dir = resolve (name, last);
   struct inode *inode = NULL;
 
-  lock_acquire(&remove_create);
-
   if (dir != NULL)
-    dir_lookup (dir, name, &inode);
+    dir_lookup (dir, last, &inode);
   dir_close (dir);
 
-  struct file *f = file_open (inode);
-
-  lock_release(&remove_create);
-
-  return f;
+  return file_open (inode);
 }
 
-/* Deletes the file named NAME.
+/* Deletes the file or empty directory named NAME.
    Returns true if successful, false on failure.
    Fails if no file named NAME exists,
    or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) 
 {
-  lock_acquire(&remove_create);
+  char last[NAME_MAX + 1];
+  struct dir *dir;
+  bool success;
 
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  journal_begin ();
+  dir = resolve (name, last);
+  success = dir != NULL && dir_remove (dir, last);
   dir_close (dir); 
-
-  lock_release(&remove_create);
+  journal_end ();
+  inode_free_removed ();
 
   return success;
 }
-
+
+/* Changes the running thread's working directory to NAME.
+   Returns true if successful, false on failure. */
+bool
+filesys_chdir (const char *name)
+{
+  struct thread *cur = thread_current ();
+  char last[NAME_MAX + 1];
+  struct dir *dir = resolve (name, last);
+  struct inode *inode = NULL;
+
+  if (dir != NULL)
+    dir_lookup (dir, last, &inode);
+  dir_close (dir);
+
+  dir = dir_open (inode);
+  if (dir == NULL)
+    return false;
+  dir_close (cur->cwd);
+  cur->cwd = dir;
+  return true;
+}
+
 /* Formats the file system. */
 static void
 do_format (void)
 {
   printf ("Formatting file system...");
   free_map_create ();
-  if (!dir_create (ROOT_DIR_SECTOR, 16))
+  if (!dir_create (ROOT_DIR_SECTOR, ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
+  journal_create ();
   free_map_close ();
   printf ("done.\n");
 }
@@ -4,19 +4,155 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
+static struct bitmap *disk_map;      /* Free map as written to disk. */
+static struct lock free_map_lock;    /* Protects free_map, disk_map,
+                                        next_fit, free_cnt and
+                                        reserved_cnt. */
+
+/* Where a search for free sectors without a goal begins, just
+   past the last sectors allocated.  Starting there, rather than
+   at sector 0, spreads new files over the free space instead of
+   packing them into the first holes, which leaves room after
+   each file for it to grow into. */
+static disk_sector_t next_fit;
+
+/* Sectors can be reserved ahead of their allocation, without
+   picking which ones, by free_map_reserve().  Allocations leave
+   reserved_cnt sectors free, except for the ones that a thread
+   has been allowed to take from the reservation with
+   free_map_use_reserved(). */
+static size_t free_cnt;              /* Number of free sectors. */
+static size_t reserved_cnt;          /* Number of reserved sectors. */
+
+/* Sectors can also be held, by free_map_hold_near() and
+   free_map_hold_at(), for an allocation that may or may not
+   follow.  A held sector is marked in free_map, so that nothing
+   else is allocated there, and does not count as free, but it is
+   not marked in disk_map, the copy of the free map that goes to
+   disk.  free_map_claim() allocates it for good, and
+   free_map_unhold() makes it free again without writing
+   anything.  A crash thus frees every sector that was held. */
+
+/* Each change to the free map writes back only the part of the
+   bitmap that holds the changed bits, usually a single word.
+   The write goes to the buffer cache, so changes to the same
+   sector of the free map are combined and reach the disk
+   together when that sector is flushed. */
 
 /* Initializes the free map. */
 void
 free_map_init (void) 
 {
-  free_map = bitmap_create (disk_size (filesys_disk));
-  if (free_map == NULL)
+  struct bitmap *maps[2];
+  int i;
+
+  lock_init (&free_map_lock);
+  maps[0] = free_map = bitmap_create (disk_size (filesys_disk));
+  maps[1] = disk_map = bitmap_create (disk_size (filesys_disk));
+  if (free_map == NULL || disk_map == NULL)
     PANIC ("bitmap creation failed--disk is too large");
-  bitmap_mark (free_map, FREE_MAP_SECTOR);
-  bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  for (i = 0; i < 2; i++)
+    {
+      bitmap_mark (maps[i], FREE_MAP_SECTOR);
+      bitmap_mark (maps[i], ROOT_DIR_SECTOR);
+      bitmap_set_multiple (maps[i], JOURNAL_SECTOR, 1 + JOURNAL_SIZE, true);
+    }
+  free_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), false);
+  reserved_cnt = 0;
+}
+
+/* Accounts for the allocation of CNT sectors, taking as many of
+   them as it can from the running thread's reserved sectors, and
+   stores that number in *OWNP.  Returns false, without changing
+   anything, if the allocation would take sectors reserved for
+   others.  The caller must hold free_map_lock. */
+static bool
+take_free (size_t cnt, size_t *ownp)
+{
+  struct thread *t = thread_current ();
+  size_t own = cnt < t->free_map_reserved ? cnt : t->free_map_reserved;
+
+  ASSERT (lock_held_by_current_thread (&free_map_lock));
+
+  if (free_cnt + own < reserved_cnt + cnt)
+    return false;
+  t->free_map_reserved -= own;
+  reserved_cnt -= own;
+  free_cnt -= cnt;
+  *ownp = own;
+  return true;
+}
+
+/* Undoes take_free (CNT, &OWN) after the allocation failed. */
+static void
+untake_free (size_t cnt, size_t own)
+{
+  ASSERT (lock_held_by_current_thread (&free_map_lock));
+
+  thread_current ()->free_map_reserved += own;
+  reserved_cnt += own;
+  free_cnt += cnt;
+}
+
+/* Marks the CNT sectors starting at SECTOR, which are marked in
+   free_map, as in use in disk_map too, and writes the change
+   back.  Returns true if successful, false if the write fails, in
+   which case disk_map is unchanged.  The caller must hold
+   free_map_lock. */
+static bool
+commit (disk_sector_t sector, size_t cnt)
+{
+  ASSERT (lock_held_by_current_thread (&free_map_lock));
+  ASSERT (bitmap_all (free_map, sector, cnt));
+  ASSERT (bitmap_none (disk_map, sector, cnt));
+
+  bitmap_set_multiple (disk_map, sector, cnt, true);
+  if (free_map_file != NULL
+      && !bitmap_write_range (disk_map, free_map_file, sector, cnt))
+    {
+      bitmap_set_multiple (disk_map, sector, cnt, false);
+      return false;
+    }
+  return true;
+}
+
+/* Finds CNT consecutive free sectors in the free map and marks
+   them used.  Unless HOLD is true, also writes the change back.
+   Searches from GOAL to the end of the disk, then from next_fit,
+   then from the start of the disk.  Returns the first sector, or
+   BITMAP_ERROR if there is no such run.  The caller must hold
+   free_map_lock. */
+static size_t
+allocate (disk_sector_t goal, size_t cnt, bool hold)
+{
+  size_t sector;
+  size_t own;
+
+  ASSERT (lock_held_by_current_thread (&free_map_lock));
+
+  if (!take_free (cnt, &own))
+    return BITMAP_ERROR;
+  sector = bitmap_scan_and_flip (free_map, goal, cnt, false);
+  if (sector == BITMAP_ERROR && next_fit < goal)
+    sector = bitmap_scan_and_flip (free_map, next_fit, cnt, false);
+  if (sector == BITMAP_ERROR && goal != 0)
+    sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  if (sector != BITMAP_ERROR && !hold && !commit (sector, cnt))
+    {
+      bitmap_set_multiple (free_map, sector, cnt, false); 
+      sector = BITMAP_ERROR;
+    }
+  if (sector != BITMAP_ERROR)
+    next_fit = (sector + cnt) % bitmap_size (free_map);
+  else
+    untake_free (cnt, own);
+  return sector;
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -26,26 +162,163 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) 
 {
-  disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
-    {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
-    }
+  size_t sector;
+
+  lock_acquire (&free_map_lock);
+  sector = allocate (next_fit, cnt, false);
+  lock_release (&free_map_lock);
+  if (sector != BITMAP_ERROR)
+    *sectorp = sector;
+  return sector != BITMAP_ERROR;
+}
+
+/* Allocates CNT consecutive sectors as close after sector GOAL
+   as possible and stores the first into *SECTORP.  Unless HOLD
+   is true, also writes the change back.  Returns true if
+   successful, false if no such run is available anywhere. */
+static bool
+allocate_near (disk_sector_t goal, size_t cnt, disk_sector_t *sectorp,
+               bool hold)
+{
+  size_t sector;
+
+  lock_acquire (&free_map_lock);
+  if (goal >= bitmap_size (free_map))
+    goal = next_fit;
+  sector = allocate (goal, cnt, hold);
+  lock_release (&free_map_lock);
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
   return sector != BITMAP_ERROR;
 }
 
+/* Allocates CNT consecutive sectors from the free map, as close
+   after sector GOAL as possible, and stores the first into
+   *SECTORP.  Returns true if successful, false if no such run is
+   available anywhere. */
+bool
+free_map_allocate_near (disk_sector_t goal, size_t cnt,
+                        disk_sector_t *sectorp)
+{
+  return allocate_near (goal, cnt, sectorp, false);
+}
+
+/* Holds CNT consecutive sectors, as close after sector GOAL as
+   possible, until free_map_claim() or free_map_unhold(), and
+   stores the first into *SECTORP.  Returns true if successful,
+   false if no such run is available anywhere. */
+bool
+free_map_hold_near (disk_sector_t goal, size_t cnt, disk_sector_t *sectorp)
+{
+  return allocate_near (goal, cnt, sectorp, true);
+}
+
+/* Holds the CNT consecutive sectors starting at SECTOR, if they
+   are all free, until free_map_claim() or free_map_unhold().
+   Returns true if successful, false otherwise. */
+bool
+free_map_hold_at (disk_sector_t sector, size_t cnt)
+{
+  bool success = false;
+  size_t own;
+
+  lock_acquire (&free_map_lock);
+  if (sector + cnt <= bitmap_size (free_map)
+      && bitmap_none (free_map, sector, cnt)
+      && take_free (cnt, &own))
+    {
+      bitmap_set_multiple (free_map, sector, cnt, true);
+      success = true;
+    }
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Allocates the CNT held sectors starting at SECTOR for good.
+   Returns true if successful, false if writing the free map
+   fails, in which case they are still held. */
+bool
+free_map_claim (disk_sector_t sector, size_t cnt)
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  success = commit (sector, cnt);
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Makes the CNT held sectors starting at SECTOR free again. */
+void
+free_map_unhold (disk_sector_t sector, size_t cnt)
+{
+  lock_acquire (&free_map_lock);
+  ASSERT (bitmap_all (free_map, sector, cnt));
+  ASSERT (bitmap_none (disk_map, sector, cnt));
+  bitmap_set_multiple (free_map, sector, cnt, false);
+  free_cnt += cnt;
+  lock_release (&free_map_lock);
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (disk_sector_t sector, size_t cnt)
 {
-  ASSERT (bitmap_all (free_map, sector, cnt));
+  journal_revoke (sector, cnt);
+
+  lock_acquire (&free_map_lock);
+  ASSERT (bitmap_all (disk_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  bitmap_set_multiple (disk_map, sector, cnt, false);
+  bitmap_write_range (disk_map, free_map_file, sector, cnt);
+  free_cnt += cnt;
+  lock_release (&free_map_lock);
+}
+
+/* Reserves CNT free sectors, so that later allocations of that
+   many sectors, made under free_map_use_reserved(), cannot fail
+   for lack of space.  Returns true if successful, false if fewer
+   than CNT free sectors are not reserved already. */
+bool
+free_map_reserve (size_t cnt)
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  success = free_cnt >= reserved_cnt + cnt;
+  if (success)
+    reserved_cnt += cnt;
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Gives back CNT sectors reserved by free_map_reserve(). */
+void
+free_map_unreserve (size_t cnt)
+{
+  lock_acquire (&free_map_lock);
+  ASSERT (reserved_cnt >= cnt);
+  reserved_cnt -= cnt;
+  lock_release (&free_map_lock);
+}
+
+/* Lets the running thread's allocations take CNT sectors reserved
+   by free_map_reserve(), until free_map_end_reserved(). */
+void
+free_map_use_reserved (size_t cnt)
+{
+  thread_current ()->free_map_reserved += cnt;
+}
+
+/* Gives back the reserved sectors that the running thread was
+   allowed to take by free_map_use_reserved() but did not. */
+void
+free_map_end_reserved (void)
+{
+  struct thread *t = thread_current ();
+
+  free_map_unreserve (t->free_map_reserved);
+  t->free_map_reserved = 0;
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -55,8 +328,10 @@ free_map_open (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
-  if (!bitmap_read (free_map, free_map_file))
+  if (!bitmap_read (disk_map, free_map_file)
+      || !bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  free_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), false);
 }
 
 /* Writes the free map to disk and closes the free map file. */
@@ -71,14 +346,22 @@ free_map_close (void)
 void
 free_map_create (void) 
 {
+  struct file *file;
+
   /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
     PANIC ("free map creation failed");
 
-  /* Write bitmap to file. */
-  free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
-  if (free_map_file == NULL)
+  /* Write bitmap to file.  The first write allocates the file's
+     sectors, which marks them in the bitmap.  free_map_file is
+     still null then, so that those allocations do not write the
+     bitmap recursively.  The second write stores the result. */
+  file = file_open (inode_open (FREE_MAP_SECTOR));
+  if (file == NULL)
     PANIC ("can't open free map");
-  if (!bitmap_write (free_map, free_map_file))
+  if (!bitmap_write (disk_map, file))
+    PANIC ("can't write free map");
+  free_map_file = file;
+  if (!bitmap_write (disk_map, free_map_file))
     PANIC ("can't write free map");
 }
@@ -12,6 +12,18 @@ void free_map_open (void);
 void free_map_close (void);
 
 bool free_map_allocate (size_t, disk_sector_t *);
+bool free_map_allocate_near (disk_sector_t goal, size_t,
+                             disk_sector_t *);
 void free_map_release (disk_sector_t, size_t);
 
+bool free_map_hold_near (disk_sector_t goal, size_t, disk_sector_t *);
+bool free_map_hold_at (disk_sector_t, size_t);
+bool free_map_claim (disk_sector_t, size_t);
+void free_map_unhold (disk_sector_t, size_t);
+
+bool free_map_reserve (size_t);
+void free_map_unreserve (size_t);
+void free_map_use_reserved (size_t);
+void free_map_end_reserved (void);
+
 #endif /* filesys/free-map.h */
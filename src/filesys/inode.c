@@ -1,29 +1,112 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
 
-/* Identifies an inode. */
-#define INODE_MAGIC 0x494e4f44
+/* Identifies an inode.  The magic numbers also tell which of
+   the layouts below the inode uses. */
+#define INODE_MAGIC 0x494e4f44          /* Indexed layout. */
+#define EXTENT_MAGIC 0x494e4f45         /* Extent layout. */
+#define INLINE_MAGIC 0x494e4f49         /* Inline layout. */
+
+/* Number of data sectors that an inode points to directly. */
+#define DIRECT_CNT 123
+
+/* Number of sector numbers that fit in an indirect block. */
+#define PTRS_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (disk_sector_t))
+
+/* Largest number of data sectors in an indexed file. */
+#define MAX_FILE_SECTORS (DIRECT_CNT + PTRS_PER_SECTOR \
+                          + PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+
+/* A run of COUNT consecutive sectors starting at disk sector
+   START, holding data sectors LOGICAL through LOGICAL + COUNT - 1
+   of a file. */
+struct extent
+  {
+    disk_sector_t logical;              /* First data sector of file. */
+    disk_sector_t start;                /* First disk sector. */
+    disk_sector_t count;                /* Number of sectors. */
+  };
+
+/* Number of extents held in the inode itself. */
+#define INODE_EXTENT_CNT 41
+
+/* Number of extents that fit in an extent block. */
+#define EXTENTS_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (struct extent))
+
+/* Largest number of extents in a file. */
+#define MAX_EXTENTS (INODE_EXTENT_CNT \
+                     + PTRS_PER_SECTOR * EXTENTS_PER_SECTOR)
+
+/* Largest file whose data is kept in the inode itself. */
+#define INLINE_SIZE ((DIRECT_CNT + 2) * sizeof (disk_sector_t))
 
 /* On-disk inode.
-   Must be exactly DISK_SECTOR_SIZE bytes long. */
+   Must be exactly DISK_SECTOR_SIZE bytes long.
+
+   With the indexed layout (INODE_MAGIC), data sector I of the
+   file is direct[I] for the first DIRECT_CNT sectors.  The next
+   PTRS_PER_SECTOR sectors are listed in the indirect block, and
+   the rest are reached through the doubly indirect block, whose
+   entries point to further indirect blocks.  A sector number of
+   0 means "not allocated"; sector 0 holds the free map inode, so
+   it is never a data sector.
+
+   With the extent layout (EXTENT_MAGIC), the file's data sectors
+   are described by EXTENT_CNT extents sorted by logical sector.
+   The first INODE_EXTENT_CNT are in the inode.  The rest are in
+   extent blocks, EXTENTS_PER_SECTOR to a block, whose sector
+   numbers are listed in the overflow block.
+
+   With the inline layout (INLINE_MAGIC), the file's data is kept
+   in the inode, in place of either of the above, and the file
+   has no data sectors.  Files are created inline if they are no
+   more than INLINE_SIZE bytes long, and are moved out to data
+   sectors when a write takes them past that.  Bytes past the end
+   of an inline file are always zero. */
 struct inode_disk
   {
-    disk_sector_t start;                /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
-  };
+    uint32_t is_dir;                    /* 1 if a directory, 0 if not. */
+    union
+      {
+        /* Indexed layout. */
+        struct
+          {
+            disk_sector_t direct[DIRECT_CNT];   /* Direct data sectors. */
+            disk_sector_t indirect;             /* Indirect block. */
+            disk_sector_t doubly_indirect;      /* Doubly indirect block. */
+          };
 
-  struct lock open_close;    // To synch syscalls open() and close() 
+        /* Extent layout. */
+        struct
+          {
+            uint32_t extent_cnt;                /* Number of extents. */
+            disk_sector_t overflow;             /* Overflow block, or 0. */
+            struct extent extents[INODE_EXTENT_CNT];
+          };
+
+        /* Inline layout. */
+        uint8_t inline_data[INLINE_SIZE];       /* File data. */
+      };
+  };
 
-  struct lock map_lock;       // For free_map_allocate and free_map_release
+/* If true, inode_create() uses the extent layout for new files.
+   If false (default), it uses the indexed layout.
+   Set by kernel command-line option "-extents". */
+bool inode_use_extents;
 
 /* Returns the number of sectors to allocate for an inode SIZE
    bytes long. */
@@ -33,19 +116,876 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 }
 
+/* A sector's worth of zeros. */
+static char zeros[DISK_SECTOR_SIZE];
+
 /* In-memory inode. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
+    struct hash_elem elem;              /* Element in open_inodes. */
+    struct list_elem removed_elem;      /* Element in removed_inodes. */
     disk_sector_t sector;               /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
+    bool loading;                       /* Being read; see inode_open(). */
+    bool closing;                       /* Being closed; see inode_close(). */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    off_t read_ahead_pos;               /* Where a sequential read resumes. */
+    off_t read_ahead_end;               /* End of sectors queued so far. */
+    size_t read_ahead_window;           /* Sectors to read ahead. */
+    disk_sector_t prealloc_start;       /* First preallocated sector. */
+    size_t prealloc_cnt;                /* Number of preallocated sectors. */
+    size_t delay_idx;                   /* First delayed data sector. */
+    size_t delay_cnt;                   /* Number of delayed sectors. */
+    int64_t delay_time;                 /* Timer tick when first delayed. */
+    struct lock lock;                   /* See inode_lock(). */
+    struct rwlock rwlock;               /* See inode_read_at(). */
     struct inode_disk data;             /* Inode content. */
   };
 
-/* Returns the disk sector that contains byte offset POS within
-   INODE.
+/* Returns entry IDX of the indirect block in SECTOR. */
+static disk_sector_t
+read_ptr (disk_sector_t sector, size_t idx)
+{
+  disk_sector_t ptr;
+
+  ASSERT (idx < PTRS_PER_SECTOR);
+  cache_read_at (sector, &ptr, sizeof ptr, idx * sizeof ptr);
+  return ptr;
+}
+
+/* Sets entry IDX of the indirect block in SECTOR to PTR. */
+static void
+write_ptr (disk_sector_t sector, size_t idx, disk_sector_t ptr)
+{
+  ASSERT (idx < PTRS_PER_SECTOR);
+  journal_write_at (sector, &ptr, sizeof ptr, idx * sizeof ptr);
+}
+
+/* Returns the sector that holds data sector IDX of the indexed
+   file described by DISK_INODE, or 0 if that sector is not
+   allocated. */
+static disk_sector_t
+index_lookup (const struct inode_disk *disk_inode, size_t idx)
+{
+  disk_sector_t indirect;
+
+  if (idx < DIRECT_CNT)
+    return disk_inode->direct[idx];
+  idx -= DIRECT_CNT;
+
+  if (idx < PTRS_PER_SECTOR)
+    return (disk_inode->indirect != 0
+            ? read_ptr (disk_inode->indirect, idx) : 0);
+  idx -= PTRS_PER_SECTOR;
+
+  if (idx >= PTRS_PER_SECTOR * PTRS_PER_SECTOR
+      || disk_inode->doubly_indirect == 0)
+    return 0;
+  indirect = read_ptr (disk_inode->doubly_indirect, idx / PTRS_PER_SECTOR);
+  return indirect != 0 ? read_ptr (indirect, idx % PTRS_PER_SECTOR) : 0;
+}
+
+/* Returns true if INODE's data is file system metadata, which is
+   written through the journal.  That is the case for directories
+   and for the free map. */
+static bool
+is_metadata (const struct inode *inode)
+{
+  return inode->data.is_dir || inode->sector == FREE_MAP_SECTOR;
+}
+
+/* Delayed allocation.
+
+   A write to a hole does not allocate a disk sector for it right
+   away.  Instead, the data is cached under a stand-in sector
+   number (see cache_write_delayed_at()), and the data sector is
+   "delayed".  Each inode has at most one range of consecutive
+   delayed data sectors, and the whole range is allocated at once,
+   as a single run of sectors.  A file written a little at a time
+   is thus laid out as well as one written in one go, and the free
+   map is searched once per range rather than once per write.
+
+   A range is allocated when it reaches DELAY_MAX sectors, when a
+   write to a hole does not continue it, before inode_allocate(),
+   when its inode is flushed or closed, on inode_sync(), and by
+   the delalloc thread once it is older than cache_flush_age.
+   Delayed sectors cannot leave the cache until then, so no more
+   than CACHE_DELAYED_MAX of them exist at a time.  Past that,
+   writes allocate sectors right away.
+
+   Metadata is never delayed.  A range reserves space in the free
+   map for its sectors, and for the metadata blocks that mapping
+   them may take, as each sector is delayed, so allocating the
+   range later cannot run out of space.  A write to a hole that
+   cannot reserve space allocates it right away instead, and comes
+   up short then if the disk is full. */
+
+/* Largest number of sectors in an inode's delayed range. */
+#define DELAY_MAX 16
+
+/* Most metadata blocks that allocating a delayed range can take:
+   two indirect blocks and a doubly indirect block, or two extent
+   blocks and an overflow block. */
+#define DELAY_META_MAX 3
+
+/* Delayed sector I of the inode in sector S is cached as sector
+   DELAYED_BASE + S * DELAY_MAX + I, which is beyond any disk that
+   this file system supports. */
+#define DELAYED_BASE 0x80000000
+
+/* How often the delalloc thread wakes up, in timer ticks. */
+#define DELAY_PERIOD (TIMER_FREQ / 2)
+
+/* Number of delayed sectors in all inodes. */
+static size_t delayed_cnt;
+
+/* Protects delayed_cnt. */
+static struct lock delayed_lock;
+
+/* Returns true if SECTOR is a stand-in for a delayed sector. */
+static inline bool
+is_delayed (disk_sector_t sector)
+{
+  return sector >= DELAYED_BASE;
+}
+
+/* Returns the stand-in for sector I of INODE's delayed range. */
+static disk_sector_t
+delayed_sector (const struct inode *inode, size_t i)
+{
+  ASSERT (i < DELAY_MAX);
+  ASSERT (inode->sector < (UINT32_MAX - DELAYED_BASE) / DELAY_MAX);
+  return DELAYED_BASE + inode->sector * DELAY_MAX + i;
+}
+
+/* Writes SIZE bytes from BUFFER into data sector SECTOR of INODE,
+   starting at byte OFFSET within the sector. */
+static void
+write_data (const struct inode *inode, disk_sector_t sector,
+            const void *buffer, off_t size, off_t offset)
+{
+  if (is_delayed (sector))
+    cache_write_delayed_at (sector, buffer, size, offset);
+  else if (is_metadata (inode))
+    journal_write_at (sector, buffer, size, offset);
+  else
+    cache_write_at (sector, buffer, size, offset);
+}
+
+/* Fills the CNT data sectors of INODE starting at SECTOR with
+   zeros. */
+static void
+zero_sectors (const struct inode *inode, disk_sector_t sector, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    write_data (inode, sector + i, zeros, DISK_SECTOR_SIZE, 0);
+}
+
+/* Allocates a run of consecutive sectors from the free map, as
+   close after sector GOAL as possible, and stores the first into
+   *SECTORP.  Tries for CNT sectors, then for half as many, and
+   so on.  Returns the number of sectors allocated, or 0 if the
+   disk is full. */
+static size_t
+allocate_run (disk_sector_t goal, size_t cnt, disk_sector_t *sectorp)
+{
+  for (; cnt > 0; cnt /= 2)
+    if (free_map_allocate_near (goal, cnt, sectorp))
+      break;
+  return cnt;
+}
+
+/* Like allocate_run(), but only holds the sectors (see
+   free_map_hold_near()). */
+static size_t
+hold_run (disk_sector_t goal, size_t cnt, disk_sector_t *sectorp)
+{
+  for (; cnt > 0; cnt /= 2)
+    if (free_map_hold_near (goal, cnt, sectorp))
+      break;
+  return cnt;
+}
+
+/* Holds a run of consecutive sectors starting at SECTOR, trying
+   for CNT sectors, then for half as many, and so on.  Returns the
+   number of sectors held, or 0 if SECTOR is in use. */
+static size_t
+extend_run (disk_sector_t sector, size_t cnt)
+{
+  for (; cnt > 0; cnt /= 2)
+    if (free_map_hold_at (sector, cnt))
+      break;
+  return cnt;
+}
+
+/* Number of sectors set aside for an inode each time it
+   allocates a run for a write.  Later writes that continue where
+   this one left off take the rest of the window, so files that
+   grow at the same time do not interleave on disk one sector at
+   a time.  The window is only held in the free map in memory, so
+   it never reaches the disk, and a crash cannot leak it. */
+#define PREALLOC_SECTORS 8
+
+/* Returns INODE's preallocated sectors to the free map. */
+static void
+release_prealloc (struct inode *inode)
+{
+  if (inode->prealloc_cnt > 0)
+    {
+      free_map_unhold (inode->prealloc_start, inode->prealloc_cnt);
+      inode->prealloc_cnt = 0;
+    }
+}
+
+/* Allocates up to CNT consecutive sectors for INODE, as close
+   after sector GOAL as possible, and stores the first into
+   *SECTORP.  Returns the number of sectors allocated, or 0 if the
+   disk is full.
+
+   Sectors come from INODE's preallocation window if it starts
+   at GOAL.  Otherwise the window is dropped, and a new run of at
+   least PREALLOC_SECTORS is held, starting at GOAL itself if it
+   is free.  Up to CNT of it are allocated, and the rest stays
+   held as the new window.  The caller must hold INODE's rwlock
+   for writing. */
+static size_t
+take_run (struct inode *inode, disk_sector_t goal, size_t cnt,
+          disk_sector_t *sectorp)
+{
+  size_t want = cnt > PREALLOC_SECTORS ? cnt : PREALLOC_SECTORS;
+  size_t got;
+
+  /* Allocating a delayed range takes sectors reserved for it, none
+     of which may go to a window. */
+  if (inode->delay_cnt > 0)
+    want = cnt;
+
+  if (inode->prealloc_cnt > 0 && inode->prealloc_start == goal)
+    {
+      got = cnt < inode->prealloc_cnt ? cnt : inode->prealloc_cnt;
+      if (!free_map_claim (goal, got))
+        return 0;
+      *sectorp = inode->prealloc_start;
+      inode->prealloc_start += got;
+      inode->prealloc_cnt -= got;
+      return got;
+    }
+  release_prealloc (inode);
+
+  got = extend_run (goal, want);
+  if (got != 0)
+    *sectorp = goal;
+  else
+    got = hold_run (goal, want, sectorp);
+
+  if (got > cnt)
+    {
+      inode->prealloc_start = *sectorp + cnt;
+      inode->prealloc_cnt = got - cnt;
+      got = cnt;
+    }
+  if (got > 0 && !free_map_claim (*sectorp, got))
+    {
+      free_map_unhold (*sectorp, got);
+      release_prealloc (inode);
+      return 0;
+    }
+  return got;
+}
+
+/* Allocates a sector from the free map, near GOAL, and fills it
+   with zeros.  Returns the sector, or 0 if the disk is full. */
+static disk_sector_t
+allocate_zeroed (disk_sector_t goal)
+{
+  disk_sector_t sector;
+
+  if (allocate_run (goal, 1, &sector) == 0)
+    return 0;
+  journal_write (sector, zeros);
+  return sector;
+}
+
+/* Makes sure that *SECTORP names an indirect block, allocating a
+   zeroed one near GOAL if it is 0.  Returns false if the disk is
+   full. */
+static bool
+install_indirect (disk_sector_t *sectorp, disk_sector_t goal)
+{
+  if (*sectorp == 0)
+    *sectorp = allocate_zeroed (goal);
+  return *sectorp != 0;
+}
+
+/* Sets data sector IDX of the indexed file described by
+   DISK_INODE to SECTOR, allocating any indirect blocks needed to
+   reach it.  Updates DISK_INODE in memory only; the caller must
+   write it back.  Returns false if the disk is full or IDX is
+   too large. */
+static bool
+index_map (struct inode_disk *disk_inode, size_t idx, disk_sector_t sector)
+{
+  disk_sector_t indirect;
+
+  if (idx < DIRECT_CNT)
+    {
+      disk_inode->direct[idx] = sector;
+      return true;
+    }
+  idx -= DIRECT_CNT;
+
+  if (idx < PTRS_PER_SECTOR)
+    {
+      if (!install_indirect (&disk_inode->indirect, sector))
+        return false;
+      write_ptr (disk_inode->indirect, idx, sector);
+      return true;
+    }
+  idx -= PTRS_PER_SECTOR;
+
+  if (idx >= PTRS_PER_SECTOR * PTRS_PER_SECTOR
+      || !install_indirect (&disk_inode->doubly_indirect, sector))
+    return false;
+  indirect = read_ptr (disk_inode->doubly_indirect, idx / PTRS_PER_SECTOR);
+  if (indirect == 0)
+    {
+      if (!install_indirect (&indirect, sector))
+        return false;
+      write_ptr (disk_inode->doubly_indirect, idx / PTRS_PER_SECTOR,
+                 indirect);
+    }
+  write_ptr (indirect, idx % PTRS_PER_SECTOR, sector);
+  return true;
+}
+
+/* Allocates data sector IDX of indexed file INODE, and up to
+   CNT - 1 of the holes that follow it, as one run of sectors, as
+   close after sector GOAL as possible.  Returns the first sector
+   of the run, or 0 on failure.  If ZERO is true, zeros the run
+   before it is mapped. */
+static disk_sector_t
+index_allocate (struct inode *inode, size_t idx, size_t cnt,
+                disk_sector_t goal, bool zero)
+{
+  struct inode_disk *disk_inode = &inode->data;
+  disk_sector_t sector;
+  size_t got, i;
+
+  /* Stop at the first data sector that is already allocated. */
+  for (i = 1; i < cnt; i++)
+    if (index_lookup (disk_inode, idx + i) != 0)
+      break;
+  cnt = i;
+
+  got = take_run (inode, goal, cnt, &sector);
+  if (got == 0)
+    return 0;
+
+  if (zero)
+    zero_sectors (inode, sector, got);
+  for (i = 0; i < got; i++)
+    if (!index_map (disk_inode, idx + i, sector + i))
+      {
+        free_map_release (sector + i, got - i);
+        return i > 0 ? sector : 0;
+      }
+  return sector;
+}
+
+/* Number of sectors whose bits fill one sector of the free map.
+   Releasing that many consecutive sectors logs at most two
+   sectors of the free map. */
+#define RELEASE_MAX (DISK_SECTOR_SIZE * 8)
+
+/* Releases the CNT sectors starting at SECTOR, which belong to a
+   file whose blocks are being freed.  If SPLIT is true, they are
+   released in pieces of at most RELEASE_MAX sectors, and the
+   running journal handle is restarted whenever it has no room
+   left for another piece (see journal_extend()). */
+static void
+release_run (disk_sector_t sector, size_t cnt, bool split)
+{
+  while (cnt > 0)
+    {
+      size_t piece = cnt;
+
+      if (split)
+        {
+          if (piece > RELEASE_MAX)
+            piece = RELEASE_MAX;
+          journal_extend (2);
+        }
+      free_map_release (sector, piece);
+      sector += piece;
+      cnt -= piece;
+    }
+}
+
+/* Releases the sectors listed in indirect block SECTOR.  If
+   LEVEL is 2, they are indirect blocks themselves and are
+   released recursively.  Then releases SECTOR.  SPLIT is as for
+   release_run(). */
+static void
+release_indirect (disk_sector_t sector, int level, bool split)
+{
+  size_t i;
+
+  for (i = 0; i < PTRS_PER_SECTOR; i++)
+    {
+      disk_sector_t ptr = read_ptr (sector, i);
+      if (ptr == 0)
+        continue;
+      if (level > 1)
+        release_indirect (ptr, level - 1, split);
+      else
+        release_run (ptr, 1, split);
+    }
+  release_run (sector, 1, split);
+}
+
+/* Releases all data sectors and indirect blocks of the indexed
+   file described by DISK_INODE.  SPLIT is as for
+   release_run(). */
+static void
+index_release (struct inode_disk *disk_inode, bool split)
+{
+  size_t i;
+
+  for (i = 0; i < DIRECT_CNT; i++)
+    if (disk_inode->direct[i] != 0)
+      release_run (disk_inode->direct[i], 1, split);
+  if (disk_inode->indirect != 0)
+    release_indirect (disk_inode->indirect, 1, split);
+  if (disk_inode->doubly_indirect != 0)
+    release_indirect (disk_inode->doubly_indirect, 2, split);
+}
+
+/* Reads extent IDX of the extent file described by DISK_INODE
+   into *E. */
+static void
+get_extent (const struct inode_disk *disk_inode, size_t idx,
+            struct extent *e)
+{
+  ASSERT (idx < disk_inode->extent_cnt);
+  if (idx < INODE_EXTENT_CNT)
+    *e = disk_inode->extents[idx];
+  else
+    {
+      idx -= INODE_EXTENT_CNT;
+      cache_read_at (read_ptr (disk_inode->overflow,
+                               idx / EXTENTS_PER_SECTOR),
+                     e, sizeof *e, idx % EXTENTS_PER_SECTOR * sizeof *e);
+    }
+}
+
+/* Sets extent IDX of the extent file described by DISK_INODE to
+   *E.  The extent block that holds it must already exist. */
+static void
+put_extent (struct inode_disk *disk_inode, size_t idx,
+            const struct extent *e)
+{
+  ASSERT (idx < MAX_EXTENTS);
+  if (idx < INODE_EXTENT_CNT)
+    disk_inode->extents[idx] = *e;
+  else
+    {
+      idx -= INODE_EXTENT_CNT;
+      journal_write_at (read_ptr (disk_inode->overflow,
+                                  idx / EXTENTS_PER_SECTOR),
+                        e, sizeof *e, idx % EXTENTS_PER_SECTOR * sizeof *e);
+    }
+}
+
+/* Returns the index of the first extent of the extent file
+   described by DISK_INODE that starts after data sector IDX, or
+   the number of extents if there is none.  Binary searches the
+   extents, so a file made of a few long extents costs only a few
+   comparisons. */
+static size_t
+extent_search (const struct inode_disk *disk_inode, size_t idx)
+{
+  size_t lo = 0;
+  size_t hi = disk_inode->extent_cnt;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      struct extent e;
+
+      get_extent (disk_inode, mid, &e);
+      if (e.logical <= idx)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* Returns the sector that holds data sector IDX of the extent
+   file described by DISK_INODE, or 0 if that sector is not
+   allocated. */
+static disk_sector_t
+extent_lookup (const struct inode_disk *disk_inode, size_t idx)
+{
+  struct extent e;
+  size_t lo;
+
+  /* Find the first extent that starts after IDX. */
+  lo = extent_search (disk_inode, idx);
+  if (lo == 0)
+    return 0;
+
+  /* IDX can only be in the extent before it. */
+  get_extent (disk_inode, lo - 1, &e);
+  return idx - e.logical < e.count ? e.start + (idx - e.logical) : 0;
+}
+
+/* Maps the CNT data sectors starting at IDX of the extent file
+   described by DISK_INODE, which must not be allocated, to the
+   CNT disk sectors starting at SECTOR.  Grows the extent before
+   them if they continue it, and otherwise inserts a new extent.
+   Returns false if the disk is full or the file has run out of
+   extents. */
+static bool
+extent_map (struct inode_disk *disk_inode, size_t idx,
+            disk_sector_t sector, size_t cnt)
+{
+  size_t pos = extent_search (disk_inode, idx);
+  size_t n = disk_inode->extent_cnt;
+  struct extent e;
+
+  if (pos > 0)
+    {
+      get_extent (disk_inode, pos - 1, &e);
+      if (e.logical + e.count == idx && e.start + e.count == sector)
+        {
+          e.count += cnt;
+          put_extent (disk_inode, pos - 1, &e);
+          return true;
+        }
+    }
+
+  /* Make sure there is room for another extent. */
+  if (n >= MAX_EXTENTS)
+    return false;
+  if (n >= INODE_EXTENT_CNT)
+    {
+      size_t block = (n - INODE_EXTENT_CNT) / EXTENTS_PER_SECTOR;
+      disk_sector_t extent_block;
+
+      if (!install_indirect (&disk_inode->overflow, sector))
+        return false;
+      extent_block = read_ptr (disk_inode->overflow, block);
+      if (extent_block == 0)
+        {
+          if (!install_indirect (&extent_block, sector))
+            return false;
+          write_ptr (disk_inode->overflow, block, extent_block);
+        }
+    }
+
+  /* Shift the later extents up to make a hole at POS.  Done from
+     the top down, so that each extent is copied before it is
+     overwritten. */
+  for (; n > pos; n--)
+    {
+      get_extent (disk_inode, n - 1, &e);
+      put_extent (disk_inode, n, &e);
+    }
+  e.logical = idx;
+  e.start = sector;
+  e.count = cnt;
+  put_extent (disk_inode, pos, &e);
+  disk_inode->extent_cnt++;
+  return true;
+}
+
+/* Allocates data sector IDX of extent file INODE, and up to
+   CNT - 1 of the holes that follow it, as one run of sectors, as
+   close after sector GOAL as possible.  A run that continues the
+   extent before IDX on disk is merged into it.  Returns the first
+   sector of the run, or 0 on failure.  If ZERO is true, zeros the
+   run before it is mapped. */
+static disk_sector_t
+extent_allocate (struct inode *inode, size_t idx, size_t cnt,
+                 disk_sector_t goal, bool zero)
+{
+  struct inode_disk *disk_inode = &inode->data;
+  size_t pos = extent_search (disk_inode, idx);
+  disk_sector_t sector;
+  size_t got;
+  struct extent e;
+
+  /* Do not run into the next extent. */
+  if (pos < disk_inode->extent_cnt)
+    {
+      get_extent (disk_inode, pos, &e);
+      if (cnt > e.logical - idx)
+        cnt = e.logical - idx;
+    }
+
+  got = take_run (inode, goal, cnt, &sector);
+  if (got == 0)
+    return 0;
+
+  if (zero)
+    zero_sectors (inode, sector, got);
+  if (!extent_map (disk_inode, idx, sector, got))
+    {
+      free_map_release (sector, got);
+      return 0;
+    }
+  return sector;
+}
+
+/* Releases all data sectors, extent blocks and the overflow block
+   of the extent file described by DISK_INODE.  SPLIT is as for
+   release_run(). */
+static void
+extent_release (struct inode_disk *disk_inode, bool split)
+{
+  struct extent e;
+  size_t i;
+
+  for (i = 0; i < disk_inode->extent_cnt; i++)
+    {
+      get_extent (disk_inode, i, &e);
+      release_run (e.start, e.count, split);
+    }
+  if (disk_inode->overflow != 0)
+    release_indirect (disk_inode->overflow, 1, split);
+}
+
+/* Returns the sector that holds data sector IDX of the file
+   described by DISK_INODE, or 0 if that sector is not
+   allocated. */
+static disk_sector_t
+lookup_block (const struct inode_disk *disk_inode, size_t idx)
+{
+  if (disk_inode->magic == INLINE_MAGIC)
+    return 0;
+  else if (disk_inode->magic == EXTENT_MAGIC)
+    return extent_lookup (disk_inode, idx);
+  else
+    return index_lookup (disk_inode, idx);
+}
+
+/* Allocates data sector IDX of INODE, which must be a hole, and
+   returns its disk sector, or 0 if the disk is full.  CNT is the
+   number of data sectors, starting at IDX, that the caller is
+   about to write.  Up to that many are allocated as a single run,
+   so the caller finds the rest of them already allocated.
+
+   If ZERO is true, the new sectors are zeroed before they become
+   visible to readers, as is needed for holes inside the file.
+   Otherwise they hold stale data, which is fine past end of file.
+   Updates INODE's data in memory only; the caller must write it
+   back.  The caller must hold INODE's rwlock for writing. */
+static disk_sector_t
+allocate_blocks (struct inode *inode, size_t idx, size_t cnt, bool zero)
+{
+  disk_sector_t prev;
+  disk_sector_t goal;
+
+  ASSERT (cnt > 0);
+  ASSERT (rwlock_held_for_write (&inode->rwlock));
+  ASSERT (inode->data.magic != INLINE_MAGIC);
+
+  /* Aim for the sector after the one before IDX, so that a file
+     written in order is laid out in order.  The first sector of
+     a file goes right after its inode. */
+  prev = idx > 0 ? lookup_block (&inode->data, idx - 1) : 0;
+  goal = prev != 0 ? prev + 1 : inode->sector + 1;
+
+  if (inode->data.magic == EXTENT_MAGIC)
+    return extent_allocate (inode, idx, cnt, goal, zero);
+  else
+    return index_allocate (inode, idx, cnt, goal, zero);
+}
+
+/* Releases all data sectors and metadata blocks of the file
+   described by DISK_INODE.  If SPLIT is true, the caller must
+   hold an outermost journal handle and no file system lock, and
+   the release may span several handles, as a large file's blocks
+   may cover more of the free map than one handle may log.  An
+   indirect block is released only after the sectors it lists, so
+   that it stays intact while it is being read. */
+static void
+release_blocks (struct inode_disk *disk_inode, bool split)
+{
+  if (disk_inode->magic == EXTENT_MAGIC)
+    extent_release (disk_inode, split);
+  else if (disk_inode->magic == INODE_MAGIC)
+    index_release (disk_inode, split);
+}
+
+/* Returns the sector that holds data sector IDX of INODE, which
+   is the stand-in sector if it is delayed, or 0 if that sector
+   is not allocated. */
+static disk_sector_t
+data_sector (const struct inode *inode, size_t idx)
+{
+  if (idx - inode->delay_idx < inode->delay_cnt)
+    return delayed_sector (inode, idx - inode->delay_idx);
+  return lookup_block (&inode->data, idx);
+}
+
+/* Takes one of the CACHE_DELAYED_MAX delayed sectors.  Returns
+   false if they are all taken. */
+static bool
+reserve_delayed (void)
+{
+  bool success;
+
+  lock_acquire (&delayed_lock);
+  success = delayed_cnt < CACHE_DELAYED_MAX;
+  if (success)
+    delayed_cnt++;
+  lock_release (&delayed_lock);
+  return success;
+}
+
+/* Gives back CNT delayed sectors taken by reserve_delayed(). */
+static void
+unreserve_delayed (size_t cnt)
+{
+  lock_acquire (&delayed_lock);
+  ASSERT (delayed_cnt >= cnt);
+  delayed_cnt -= cnt;
+  lock_release (&delayed_lock);
+}
+
+/* Drops INODE's delayed range, and the data in it, without
+   allocating it. */
+static void
+discard_delayed (struct inode *inode)
+{
+  size_t i;
+
+  if (inode->delay_cnt == 0)
+    return;
+  for (i = 0; i < inode->delay_cnt; i++)
+    cache_discard (delayed_sector (inode, i));
+  unreserve_delayed (inode->delay_cnt);
+  free_map_unreserve (inode->delay_cnt + DELAY_META_MAX);
+  inode->delay_cnt = 0;
+}
+
+/* Allocates INODE's delayed range as one run of sectors, or as
+   few runs as the free map allows, and moves the cached data
+   into them.  The sectors come out of the range's reservation,
+   so this cannot fail.  The caller must hold a journal handle
+   and INODE's rwlock for writing. */
+static void
+allocate_delayed (struct inode *inode)
+{
+  size_t i = 0;
+
+  ASSERT (rwlock_held_for_write (&inode->rwlock));
+
+  if (inode->delay_cnt == 0)
+    return;
+  free_map_use_reserved (inode->delay_cnt + DELAY_META_MAX);
+  while (i < inode->delay_cnt)
+    {
+      /* The whole range gets written, so it needs no zeroing. */
+      disk_sector_t sector = allocate_blocks (inode, inode->delay_idx + i,
+                                              inode->delay_cnt - i, false);
+      ASSERT (sector != 0);
+
+      /* The run may be shorter than the rest of the range. */
+      do
+        {
+          cache_assign (delayed_sector (inode, i), sector);
+          i++;
+          sector++;
+        }
+      while (i < inode->delay_cnt
+             && lookup_block (&inode->data, inode->delay_idx + i) == sector);
+    }
+
+  free_map_end_reserved ();
+  unreserve_delayed (inode->delay_cnt);
+  inode->delay_cnt = 0;
+  journal_write (inode->sector, &inode->data);
+}
+
+/* Returns true if data sector IDX of INODE can join its delayed
+   range, that is, if the range with IDX added can always be
+   mapped, even if each of its sectors ends up in a separate
+   extent. */
+static bool
+can_delay (const struct inode *inode, size_t idx)
+{
+  if (inode->data.magic == EXTENT_MAGIC)
+    return inode->data.extent_cnt + inode->delay_cnt < MAX_EXTENTS;
+  else
+    return idx < MAX_FILE_SECTORS;
+}
+
+/* Makes data sector IDX of INODE, which must be a hole, a delayed
+   sector, and returns its stand-in.  First allocates INODE's
+   delayed range if IDX does not continue it or it is full.
+   Returns 0 if IDX cannot be delayed, in which case the caller
+   allocates it.  The caller must hold a journal handle and
+   INODE's rwlock for writing. */
+static disk_sector_t
+delay_block (struct inode *inode, size_t idx)
+{
+  if (is_metadata (inode))
+    return 0;
+
+  if (inode->delay_cnt > 0
+      && (idx != inode->delay_idx + inode->delay_cnt
+          || inode->delay_cnt >= DELAY_MAX))
+    allocate_delayed (inode);
+  if (!can_delay (inode, idx))
+    return 0;
+
+  /* If too many sectors are delayed, make room by allocating
+     our own. */
+  if (!reserve_delayed ())
+    {
+      allocate_delayed (inode);
+      if (!reserve_delayed ())
+        return 0;
+    }
+
+  /* A new range also reserves room for its metadata. */
+  if (!free_map_reserve (inode->delay_cnt == 0 ? 1 + DELAY_META_MAX : 1))
+    {
+      unreserve_delayed (1);
+      return 0;
+    }
+
+  if (inode->delay_cnt == 0)
+    {
+      inode->delay_idx = idx;
+      inode->delay_time = timer_ticks ();
+    }
+  return delayed_sector (inode, inode->delay_cnt++);
+}
+
+/* Allocates INODE's delayed range if it has been delayed for at
+   least MIN_AGE timer ticks. */
+static void
+flush_delayed (struct inode *inode, int64_t min_age)
+{
+  journal_begin ();
+  rwlock_acquire_write (&inode->rwlock);
+  if (inode->delay_cnt > 0 && timer_elapsed (inode->delay_time) >= min_age)
+    allocate_delayed (inode);
+  rwlock_release_write (&inode->rwlock);
+  journal_end ();
+}
+
+/* Returns the sector that contains byte offset POS within INODE,
+   which is a stand-in sector if it is delayed.
+   Returns 0 if POS falls in a hole, which reads as zeros, or if
+   INODE is inline.
    Returns -1 if INODE does not contain data for a byte at offset
    POS. */
 static disk_sector_t
@@ -53,33 +993,115 @@ byte_to_sector (const struct inode *inode, off_t pos)
 {
   ASSERT (inode != NULL);
   if (pos < inode->data.length)
-    return inode->data.start + pos / DISK_SECTOR_SIZE;
+    return data_sector (inode, pos / DISK_SECTOR_SIZE);
   else
     return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Largest number of sectors read ahead of a sequential reader. */
+#define READ_AHEAD_WINDOW_MAX 8
+
+/* Open inodes, hashed by sector, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct hash open_inodes;
+
+/* Protects open_inodes and the open_cnt of every open inode. */
+static struct lock open_inodes_lock;
+
+/* Broadcast when an inode in open_inodes has been read from disk.
+   Used with open_inodes_lock. */
+static struct condition inode_loaded;
+
+/* Removed inodes that their last opener closed inside a journal
+   handle, waiting for inode_free_removed() to free their blocks.
+   Protected by open_inodes_lock. */
+static struct list removed_inodes;
+
+static hash_hash_func inode_hash;
+static hash_less_func inode_less;
+static thread_func delalloc_daemon NO_RETURN;
+static void delete_inode (struct inode *);
+static bool allocate_chunk (struct inode *, off_t offset, off_t end,
+                            bool keep_size);
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
-  lock_init(&open_close);
+  lock_init (&open_inodes_lock);
+  cond_init (&inode_loaded);
+  hash_init (&open_inodes, inode_hash, inode_less, NULL);
+  list_init (&removed_inodes);
+  delayed_cnt = 0;
+  lock_init (&delayed_lock);
+  thread_create ("delalloc", PRI_DEFAULT, delalloc_daemon, NULL);
+}
 
-  list_init (&open_inodes);
+/* Allocates the delayed ranges of the open inodes that have been
+   delayed for at least MIN_AGE timer ticks. */
+static void
+allocate_open_delayed (int64_t min_age)
+{
+  struct inode *inodes[CACHE_DELAYED_MAX];
+  struct hash_iterator i;
+  size_t cnt = 0;
+  size_t j;
 
-  lock_init(&map_lock);
+  /* Allocating takes locks that come before open_inodes_lock, so
+     it is done after releasing it, with each inode reopened to
+     keep it from being freed.  At most CACHE_DELAYED_MAX inodes
+     have delayed sectors.  Their delay_cnt is read without their
+     rwlock, but flush_delayed() checks it again. */
+  lock_acquire (&open_inodes_lock);
+  hash_first (&i, &open_inodes);
+  while (cnt < CACHE_DELAYED_MAX && hash_next (&i))
+    {
+      struct inode *inode = hash_entry (hash_cur (&i), struct inode, elem);
+      if (inode->delay_cnt > 0)
+        {
+          inode->open_cnt++;
+          inodes[cnt++] = inode;
+        }
+    }
+  lock_release (&open_inodes_lock);
+
+  for (j = 0; j < cnt; j++)
+    {
+      flush_delayed (inodes[j], min_age);
+      inode_close (inodes[j]);
+    }
+}
+
+/* Allocates the delayed sectors of every open inode, so that
+   flushing the buffer cache afterward writes all file data to
+   disk. */
+void
+inode_sync (void)
+{
+  allocate_open_delayed (0);
+}
+
+/* Periodically allocates delayed ranges that are older than
+   cache_flush_age, so that their data is written back about as
+   soon as other dirty data. */
+static void
+delalloc_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (DELAY_PERIOD);
+      allocate_open_delayed (cache_flush_age * TIMER_FREQ / 1000);
+    }
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   disk.
+   disk.  The inode is a directory if IS_DIR is true, an ordinary
+   file otherwise.
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool
-inode_create (disk_sector_t sector, off_t length)
+inode_create (disk_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
   bool success = false;
@@ -93,78 +1115,121 @@ inode_create (disk_sector_t sector, off_t length)
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
       disk_inode->length = length;
-      disk_inode->magic = INODE_MAGIC;
+      if (length <= (off_t) INLINE_SIZE)
+        disk_inode->magic = INLINE_MAGIC;
+      else
+        disk_inode->magic = inode_use_extents ? EXTENT_MAGIC : INODE_MAGIC;
+      disk_inode->is_dir = is_dir;
 
-      lock_acquire(&map_lock);
-
-      if (free_map_allocate (sectors, &disk_inode->start))
+      /* No data sectors are allocated yet.  The whole file is a
+         hole until it is written. */
+      if (disk_inode->magic != INODE_MAGIC
+          || bytes_to_sectors (length) <= MAX_FILE_SECTORS)
         {
-          disk_write (filesys_disk, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[DISK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                disk_write (filesys_disk, disk_inode->start + i, zeros); 
-            }
+          journal_write (sector, disk_inode);
           success = true; 
         } 
 
-      lock_release(&map_lock);
-
       free (disk_inode);
     }
   return success;
 }
 
+/* Returns the hash value for the open inode in E. */
+static unsigned
+inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct inode *inode = hash_entry (e, struct inode, elem);
+  return hash_int (inode->sector);
+}
+
+/* Returns true if open inode A precedes open inode B. */
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  const struct inode *inode_a = hash_entry (a, struct inode, elem);
+  const struct inode *inode_b = hash_entry (b, struct inode, elem);
+  return inode_a->sector < inode_b->sector;
+}
+
+/* Returns the element of open_inodes for the inode in SECTOR, or
+   a null pointer if that inode is not open.  The caller must hold
+   open_inodes_lock. */
+static struct hash_elem *
+inode_lookup (disk_sector_t sector)
+{
+  /* Only the sector of the key is looked at.  The key is static,
+     rather than on the stack, because a whole `struct inode' is
+     big, and open_inodes_lock already keeps other threads out. */
+  static struct inode key;
+
+  ASSERT (lock_held_by_current_thread (&open_inodes_lock));
+  key.sector = sector;
+  return hash_find (&open_inodes, &key.elem);
+}
+
 /* Reads an inode from SECTOR
    and returns a `struct inode' that contains it.
-   Returns a null pointer if memory allocation fails. */
+   Returns a null pointer if memory allocation fails.
+
+   A new inode goes into the inode table before it is read, marked
+   as loading, and the read happens without open_inodes_lock, so
+   that opening one inode never waits for the disk on behalf of
+   another.  Whoever opens the same inode meanwhile waits for the
+   read to finish. */
 struct inode *
 inode_open (disk_sector_t sector) 
 {
-  lock_acquire(&open_close);
-
-  struct list_elem *e;
+  struct hash_elem *e;
   struct inode *inode;
 
+  lock_acquire (&open_inodes_lock);
+
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  e = inode_lookup (sector);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          lock_release(&open_close);  // Moved to before reopen()
-
-          inode_reopen (inode);
-
-          return inode; 
-        }
+      inode = hash_entry (e, struct inode, elem);
+      inode->open_cnt++;
+      while (inode->loading)
+        cond_wait (&inode_loaded, &open_inodes_lock);
+      lock_release (&open_inodes_lock);
+      return inode; 
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-  {
-    lock_release(&open_close);
-
-    return NULL;
-  }
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
   inode->open_cnt = 1;
+  inode->loading = true;
+  inode->closing = false;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  disk_read (filesys_disk, inode->sector, &inode->data);
+  inode->read_ahead_pos = inode->read_ahead_end = 0;
+  inode->read_ahead_window = 0;
+  inode->prealloc_cnt = 0;
+  inode->delay_cnt = 0;
+  lock_init (&inode->lock);
+  rwlock_init (&inode->rwlock);
+  memset (&inode->data, 0, sizeof inode->data);
+  hash_insert (&open_inodes, &inode->elem);
+  lock_release (&open_inodes_lock);
 
-  lock_release(&open_close);
+  cache_read (inode->sector, &inode->data);
 
+  lock_acquire (&open_inodes_lock);
+  inode->loading = false;
+  cond_broadcast (&inode_loaded, &open_inodes_lock);
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -172,14 +1237,13 @@ inode_open (disk_sector_t sector)
 struct inode *
 inode_reopen (struct inode *inode)
 {
-  lock_acquire(&open_close);
   if (inode != NULL) 
     {
-      ASSERT(inode->open_cnt != 0);
+      lock_acquire (&open_inodes_lock);
+      ASSERT (inode->open_cnt != 0);
       inode->open_cnt++;
+      lock_release (&open_inodes_lock);
     }
-    
-  lock_release(&open_close);
   return inode;
 }
 
@@ -196,38 +1260,105 @@ inode_get_inumber (const struct inode *inode)
 void
 inode_close (struct inode *inode) 
 {
-  lock_acquire(&open_close);
-
   /* Ignore null pointer. */
   if (inode == NULL)
-  {
-    lock_release(&open_close);
-
     return;
-  }
 
-  /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  lock_acquire (&open_inodes_lock);
+  if (--inode->open_cnt > 0 || inode->closing)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
-      /* Deallocate blocks if removed. */
-      if (inode->removed) 
-        {
-          lock_acquire(&map_lock);
+      lock_release (&open_inodes_lock);
+      return;
+    }
 
-          free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+  /* This was the last opener.  Allocating the delayed range
+     changes INODE's on-disk inode, so INODE stays in the inode
+     table until that is done.  Otherwise another thread could
+     open INODE again, read the old on-disk inode, and later write
+     it back over the new one.  Whoever opens INODE meanwhile gets
+     it as it is, and CLOSING makes sure that only one closer
+     frees it. */
+  inode->closing = true;
+  while (!inode->removed && inode->delay_cnt > 0)
+    {
+      lock_release (&open_inodes_lock);
+
+      journal_begin ();
+      rwlock_acquire_write (&inode->rwlock);
+      allocate_delayed (inode);
+      rwlock_release_write (&inode->rwlock);
+      journal_end ();
 
-          lock_release(&map_lock);
+      lock_acquire (&open_inodes_lock);
+      if (inode->open_cnt > 0)
+        {
+          /* Opened again.  The last closer takes it from here. */
+          inode->closing = false;
+          lock_release (&open_inodes_lock);
+          return;
         }
+    }
 
+  /* Remove from inode table.  Once it is out of the table nobody
+     else can reach it, so the rest needs no lock. */
+  hash_delete (&open_inodes, &inode->elem);
+  if (inode->removed && journal_in_handle ())
+    {
+      /* Freeing the blocks may take more than one handle, which
+         cannot be done inside the caller's. */
+      list_push_back (&removed_inodes, &inode->removed_elem);
+      lock_release (&open_inodes_lock);
+      return;
+    }
+  lock_release (&open_inodes_lock);
+
+  if (inode->removed)
+    delete_inode (inode);
+  else
+    {
+      release_prealloc (inode);
       free (inode); 
     }
+}
 
-    lock_release(&open_close);
+/* Frees the blocks and the inode sector of removed INODE, then
+   INODE itself.  The caller must not be inside a journal handle.
+
+   The blocks go first and the inode sector last, in as many
+   handles as it takes.  Each of them commits after the one that
+   removed INODE's directory entry, so a crash part way leaves an
+   inode that no directory refers to, holding the blocks not yet
+   freed.  Those stay allocated, as does a whole removed file
+   that was still open at the crash. */
+static void
+delete_inode (struct inode *inode)
+{
+  journal_begin ();
+  discard_delayed (inode);
+  release_prealloc (inode);
+  release_blocks (&inode->data, true);
+  release_run (inode->sector, 1, true);
+  journal_end ();
+  free (inode);
+}
+
+/* Frees the inodes that were removed and then closed for the last
+   time inside a journal handle.  Called by each file system
+   operation that may close an inode inside its handle, after the
+   handle ends. */
+void
+inode_free_removed (void)
+{
+  lock_acquire (&open_inodes_lock);
+  while (!list_empty (&removed_inodes))
+    {
+      struct list_elem *e = list_pop_front (&removed_inodes);
+
+      lock_release (&open_inodes_lock);
+      delete_inode (list_entry (e, struct inode, removed_elem));
+      lock_acquire (&open_inodes_lock);
+    }
+  lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -239,136 +1370,575 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
+/* Returns true if INODE has been removed, false otherwise. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
+/* Returns true if INODE is a directory, false otherwise. */
+bool
+inode_is_dir (const struct inode *inode)
+{
+  return inode->data.is_dir != 0;
+}
+
+/* Acquires INODE's lock.  The directory layer holds it for the
+   whole of each operation on a directory.  It also protects
+   INODE's deny_write_cnt.  See filesys.c for the order in which
+   file system locks are acquired. */
+void
+inode_lock (struct inode *inode)
+{
+  lock_acquire (&inode->lock);
+}
+
+/* Releases INODE's lock. */
+void
+inode_unlock (struct inode *inode)
+{
+  lock_release (&inode->lock);
+}
+
+/* Called after INODE has been read from byte START up to byte
+   END.  If the read continued where the previous one stopped,
+   queues the sectors that follow END for read-ahead, doubling
+   the number of sectors queued each time up to
+   READ_AHEAD_WINDOW_MAX.  Any other read resets the window.
+
+   The read_ahead_* members are only hints, so races between
+   concurrent readers of INODE are harmless. */
+static void
+read_ahead (struct inode *inode, off_t start, off_t end)
+{
+  off_t pos, limit;
+
+  if (start == inode->read_ahead_pos && start != 0)
+    {
+      inode->read_ahead_window *= 2;
+      if (inode->read_ahead_window > READ_AHEAD_WINDOW_MAX)
+        inode->read_ahead_window = READ_AHEAD_WINDOW_MAX;
+    }
+  else
+    {
+      inode->read_ahead_window = 1;
+      inode->read_ahead_end = 0;
+    }
+  inode->read_ahead_pos = end;
+
+  /* Queue whole sectors past END that are not queued yet. */
+  pos = ROUND_UP (end, DISK_SECTOR_SIZE);
+  limit = pos + inode->read_ahead_window * DISK_SECTOR_SIZE;
+  if (pos < inode->read_ahead_end)
+    pos = inode->read_ahead_end;
+  for (; pos < limit && pos < inode_length (inode); pos += DISK_SECTOR_SIZE)
+    {
+      /* Delayed sectors are always cached, and may be allocated
+         before the read-ahead thread gets to them, so only sectors
+         on disk are queued. */
+      disk_sector_t sector = lookup_block (&inode->data,
+                                           pos / DISK_SECTOR_SIZE);
+      if (sector != 0)
+        cache_read_ahead (sector);
+    }
+  if (pos > inode->read_ahead_end)
+    inode->read_ahead_end = pos;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
 off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) 
 {
-  uint8_t *buffer = buffer_;
-  off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
+  struct iovec iov;
 
-  while (size > 0) 
-    {
-      /* Disk sector to read, starting byte offset within sector. */
-      disk_sector_t sector_idx = byte_to_sector (inode, offset);
-      int sector_ofs = offset % DISK_SECTOR_SIZE;
+  iov.iov_base = buffer;
+  iov.iov_len = size;
+  return inode_readv_at (inode, &iov, 1, offset);
+}
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
-      int sector_left = DISK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
+/* Reads from INODE into the IOVCNT buffers in IOV, in order,
+   starting at position OFFSET.  Returns the number of bytes
+   actually read, which is less than the total size of the
+   buffers if end of file is reached.
 
-      /* Number of bytes to actually copy out of this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
-        break;
+   Reads hold INODE's rwlock for reading and writes hold it for
+   writing, so that a read sees all of a write or none of it,
+   however many files have INODE open.  Reads of the same inode
+   proceed in parallel. */
+off_t
+inode_readv_at (struct inode *inode, const struct iovec *iov, int iovcnt,
+                off_t offset)
+{
+  off_t start = offset;
+  int i;
 
-      if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) 
-        {
-          /* Read full sector directly into caller's buffer. */
-          disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-        }
-      else 
+  rwlock_acquire_read (&inode->rwlock);
+  for (i = 0; i < iovcnt; i++)
+    {
+      uint8_t *buffer = iov[i].iov_base;
+      off_t size = iov[i].iov_len;
+      off_t bytes_read = 0;
+
+      while (size > 0) 
         {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (DISK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          disk_read (filesys_disk, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-        }
+          /* Disk sector to read, starting byte offset within sector. */
+          disk_sector_t sector_idx = byte_to_sector (inode, offset);
+          int sector_ofs = offset % DISK_SECTOR_SIZE;
+
+          /* Bytes left in inode, bytes left in sector, lesser of the two. */
+          off_t inode_left = inode_length (inode) - offset;
+          int sector_left = DISK_SECTOR_SIZE - sector_ofs;
+          int min_left = inode_left < sector_left ? inode_left : sector_left;
+
+          /* Number of bytes to actually copy out of this sector. */
+          int chunk_size = size < min_left ? size : min_left;
+          if (chunk_size <= 0)
+            break;
+
+          /* Copy out of the inode, out of the buffer cache, or
+             zeros for a hole. */
+          if (inode->data.magic == INLINE_MAGIC)
+            memcpy (buffer + bytes_read, inode->data.inline_data + offset,
+                    chunk_size);
+          else if (sector_idx != 0)
+            cache_read_at (sector_idx, buffer + bytes_read,
+                           chunk_size, sector_ofs);
+          else
+            memset (buffer + bytes_read, 0, chunk_size);
       
-      /* Advance. */
-      size -= chunk_size;
-      offset += chunk_size;
-      bytes_read += chunk_size;
+          /* Advance. */
+          size -= chunk_size;
+          offset += chunk_size;
+          bytes_read += chunk_size;
+        }
+      if (size > 0)
+        break;
     }
-  free (bounce);
 
-  return bytes_read;
+  if (offset > start)
+    read_ahead (inode, start, offset);
+  rwlock_release_read (&inode->rwlock);
+
+  return offset - start;
+}
+
+/* Zeros the bytes of INODE from its end up to OFFSET that lie in
+   allocated sectors.  Those bytes may hold stale data, since a
+   sector is not zeroed when it is allocated past end of file.
+   That is always true of the tail of the last sector, and of
+   whole sectors past end of file that inode_allocate() reserved
+   or that a failed write left behind. */
+static void
+zero_tail (struct inode *inode, off_t offset)
+{
+  struct inode_disk *disk_inode = &inode->data;
+  int sector_ofs = disk_inode->length % DISK_SECTOR_SIZE;
+  disk_sector_t sector;
+  size_t idx;
+  off_t size;
+
+  if (offset <= disk_inode->length)
+    return;
+  idx = disk_inode->length / DISK_SECTOR_SIZE;
+  if (sector_ofs != 0)
+    {
+      sector = data_sector (inode, idx);
+      size = DISK_SECTOR_SIZE - sector_ofs;
+      if (size > offset - disk_inode->length)
+        size = offset - disk_inode->length;
+      if (sector != 0)
+        write_data (inode, sector, zeros, size, sector_ofs);
+      idx++;
+    }
+
+  /* Whole sectors up to the one that holds OFFSET. */
+  for (; idx < (size_t) offset / DISK_SECTOR_SIZE; idx++)
+    {
+      sector = data_sector (inode, idx);
+      if (sector != 0)
+        zero_sectors (inode, sector, 1);
+    }
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk becomes full or an error occurs. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
                 off_t offset) 
 {
-  const uint8_t *buffer = buffer_;
-  off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  struct iovec iov;
 
-  if (inode->deny_write_cnt)
-    return 0;
+  iov.iov_base = (void *) buffer;
+  iov.iov_len = size;
+  return inode_writev_at (inode, &iov, 1, offset);
+}
 
-  while (size > 0) 
-    {
-      /* Sector to write, starting byte offset within sector. */
-      disk_sector_t sector_idx = byte_to_sector (inode, offset);
-      int sector_ofs = offset % DISK_SECTOR_SIZE;
+/* Writes the IOVCNT buffers in IOV, which total END - OFFSET
+   bytes, into the data sectors of INODE, starting at OFFSET.
+   Returns the number of bytes actually written, which may be less
+   than the total if the disk becomes full.  A write past end of
+   file extends the inode, and any gap between the old end of file
+   and OFFSET reads as zeros.
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
-      int sector_left = DISK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
+   Data sectors are delayed as they are first written, or else
+   allocated then.  Sectors past end of file are allocated only by
+   inode_allocate() and by writes that fail part way, and are
+   zeroed as the file grows over them.  The caller must hold a
+   journal handle and INODE's rwlock for writing. */
+static off_t
+write_blocks (struct inode *inode, const struct iovec *iov, int iovcnt,
+              off_t offset, off_t end)
+{
+  off_t start = offset;
+  off_t length;
+  bool growing;
+  int i;
 
-      /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
-        break;
+  growing = end > inode_length (inode);
+  if (growing)
+    zero_tail (inode, offset);
+  length = inode_length (inode);
 
-      if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) 
-        {
-          /* Write full sector directly to disk. */
-          disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-        }
-      else 
+  for (i = 0; i < iovcnt; i++)
+    {
+      const uint8_t *buffer = iov[i].iov_base;
+      off_t size = iov[i].iov_len;
+      off_t bytes_written = 0;
+
+      while (size > 0) 
         {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
+          /* Sector to write, starting byte offset within sector. */
+          size_t idx = offset / DISK_SECTOR_SIZE;
+          disk_sector_t sector_idx;
+          int sector_ofs = offset % DISK_SECTOR_SIZE;
+
+          /* Bytes left in inode, bytes left in sector, lesser of the two. */
+          off_t inode_left = (growing ? end : inode_length (inode)) - offset;
+          int sector_left = DISK_SECTOR_SIZE - sector_ofs;
+          int min_left = inode_left < sector_left ? inode_left : sector_left;
+
+          /* Number of bytes to actually write into this sector. */
+          int chunk_size = size < min_left ? size : min_left;
+          if (chunk_size <= 0)
+            break;
+
+          sector_idx = data_sector (inode, idx);
+          if (sector_idx == 0)
+            sector_idx = delay_block (inode, idx);
+          if (sector_idx == 0)
             {
-              bounce = malloc (DISK_SECTOR_SIZE);
-              if (bounce == NULL)
+              /* First write to this sector.  A hole inside the file
+                 must read as zeros until the data is in, so it is
+                 zeroed before it is mapped.  Past end of file only
+                 the part that we do not write needs zeroing. */
+              bool in_file = (off_t) idx * DISK_SECTOR_SIZE < length;
+
+              sector_idx = allocate_blocks (inode, idx,
+                                            DIV_ROUND_UP (sector_ofs
+                                                          + end - offset,
+                                                          DISK_SECTOR_SIZE),
+                                            in_file);
+              if (sector_idx == 0)
                 break;
+              if (!in_file && chunk_size < DISK_SECTOR_SIZE)
+                zero_sectors (inode, sector_idx, 1);
+              if (!growing)
+                journal_write (inode->sector, &inode->data);
+            }
+          else if ((off_t) idx * DISK_SECTOR_SIZE >= length
+                   && chunk_size < DISK_SECTOR_SIZE
+                   && (sector_ofs == 0 || offset == start))
+            {
+              /* Allocated earlier, past end of file, so it may
+                 hold stale data.  Unless an earlier buffer of this
+                 write already started on it, zero it first. */
+              zero_sectors (inode, sector_idx, 1);
             }
 
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            disk_read (filesys_disk, sector_idx, bounce);
-          else
-            memset (bounce, 0, DISK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          disk_write (filesys_disk, sector_idx, bounce); 
+          /* Copy into the buffer cache, which reads in the rest of
+             the sector first if we are not overwriting all of it. */
+          write_data (inode, sector_idx, buffer + bytes_written,
+                      chunk_size, sector_ofs);
+
+          /* Advance. */
+          size -= chunk_size;
+          offset += chunk_size;
+          bytes_written += chunk_size;
         }
+      if (size > 0)
+        break;
+    }
+
+  if (growing)
+    {
+      if (offset > inode->data.length)
+        inode->data.length = offset;
+      journal_write (inode->sector, &inode->data);
+    }
+
+  return offset - start;
+}
+
+/* Writes the IOVCNT buffers in IOV into inline INODE, starting at
+   OFFSET.  END, the offset just past the last byte written, must
+   not exceed INLINE_SIZE.  The caller must hold a journal handle
+   and INODE's rwlock for writing. */
+static off_t
+write_inline (struct inode *inode, const struct iovec *iov, int iovcnt,
+              off_t offset, off_t end)
+{
+  struct inode_disk *disk_inode = &inode->data;
+  off_t start = offset;
+  int i;
+
+  ASSERT (end <= (off_t) INLINE_SIZE);
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      memcpy (disk_inode->inline_data + offset, iov[i].iov_base,
+              iov[i].iov_len);
+      offset += iov[i].iov_len;
+    }
+  if (end > disk_inode->length)
+    disk_inode->length = end;
+  journal_write (inode->sector, disk_inode);
+  return offset - start;
+}
+
+/* Moves the data of inline INODE out to data sectors.  Returns
+   true if successful, false if memory or disk allocation fails,
+   in which case INODE is still inline.  The caller must hold a
+   journal handle and INODE's rwlock for writing. */
+static bool
+move_inline (struct inode *inode)
+{
+  struct inode_disk *disk_inode = &inode->data;
+  struct inode_disk *copy;
+  struct iovec iov;
+  bool success;
+
+  ASSERT (disk_inode->magic == INLINE_MAGIC);
 
-      /* Advance. */
-      size -= chunk_size;
-      offset += chunk_size;
-      bytes_written += chunk_size;
+  copy = malloc (sizeof *copy);
+  if (copy == NULL)
+    return false;
+  *copy = *disk_inode;
+
+  /* Start from an empty file, then write the old data into it. */
+  memset (disk_inode->inline_data, 0, INLINE_SIZE);
+  disk_inode->magic = inode_use_extents ? EXTENT_MAGIC : INODE_MAGIC;
+  disk_inode->length = 0;
+  iov.iov_base = copy->inline_data;
+  iov.iov_len = copy->length;
+  success = write_blocks (inode, &iov, 1, 0, copy->length) == copy->length;
+  if (!success)
+    {
+      discard_delayed (inode);
+      release_prealloc (inode);
+      release_blocks (disk_inode, false);
+      *disk_inode = *copy;
+      journal_write (inode->sector, disk_inode);
     }
-  free (bounce);
+  free (copy);
+  return success;
+}
+
+/* Largest number of bytes that inode_writev_at() and
+   inode_allocate() handle inside a single journal handle.  That
+   many bytes take few enough index blocks and free map sectors
+   to stay within the sectors a handle may log (see
+   journal_begin()). */
+#define CHUNK_SIZE (64 * DISK_SECTOR_SIZE)
+
+/* Writes the IOVCNT buffers in IOV into INODE, in order, starting
+   at OFFSET and ending at END, inside a single journal handle.
+   Returns the number of bytes actually written. */
+static off_t
+write_chunk (struct inode *inode, const struct iovec *iov, int iovcnt,
+             off_t offset, off_t end)
+{
+  off_t bytes_written;
+
+  /* Allocating sectors and growing the file change metadata. */
+  journal_begin ();
+  rwlock_acquire_write (&inode->rwlock);
+
+  if (inode->data.magic == INLINE_MAGIC && end > (off_t) INLINE_SIZE
+      && !move_inline (inode))
+    bytes_written = 0;
+  else if (inode->data.magic == INLINE_MAGIC)
+    bytes_written = write_inline (inode, iov, iovcnt, offset, end);
+  else
+    bytes_written = write_blocks (inode, iov, iovcnt, offset, end);
+
+  rwlock_release_write (&inode->rwlock);
+  journal_end ();
 
   return bytes_written;
 }
 
+/* Writes the IOVCNT buffers in IOV into INODE, in order, starting
+   at OFFSET.  Their total size must fit in an off_t.  Returns the
+   number of bytes actually written, which may be less than the
+   total if the disk becomes full or an error occurs.  A write
+   past end of file extends the inode, and any gap between the
+   old end of file and OFFSET reads as zeros.
+
+   A write of up to CHUNK_SIZE bytes is atomic with respect to
+   other readers and writers.  A larger one is carried out a
+   chunk at a time. */
+off_t
+inode_writev_at (struct inode *inode, const struct iovec *iov, int iovcnt,
+                 off_t offset) 
+{
+  off_t end = offset;
+  off_t bytes_written = 0;
+  int i;
+
+  if (inode->deny_write_cnt)
+    return 0;
+  for (i = 0; i < iovcnt; i++)
+    end += iov[i].iov_len;
+  if (end - offset <= CHUNK_SIZE)
+    return write_chunk (inode, iov, iovcnt, offset, end);
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      uint8_t *buffer = iov[i].iov_base;
+      off_t size = iov[i].iov_len;
+
+      while (size > 0)
+        {
+          struct iovec chunk;
+          off_t chunk_written;
+
+          chunk.iov_base = buffer;
+          chunk.iov_len = size < CHUNK_SIZE ? size : CHUNK_SIZE;
+          chunk_written = write_chunk (inode, &chunk, 1, offset,
+                                       offset + chunk.iov_len);
+          bytes_written += chunk_written;
+          if (chunk_written < (off_t) chunk.iov_len)
+            return bytes_written;
+          buffer += chunk_written;
+          offset += chunk_written;
+          size -= chunk_written;
+        }
+    }
+  return bytes_written;
+}
+
+/* Allocates the data sectors for the SIZE bytes of INODE starting
+   at OFFSET that are not allocated yet, in runs of consecutive
+   sectors that later writes then use without going to the free
+   map.  Returns true if successful, false if the disk becomes
+   full, in which case some of the sectors may be allocated.
+
+   If KEEP_SIZE is false, INODE is extended to OFFSET + SIZE bytes
+   if it is shorter, and every new sector is zeroed.  If KEEP_SIZE
+   is true, INODE's length does not change, and sectors past end
+   of file are only reserved, not zeroed.  Holes inside the file
+   are zeroed either way. */
+bool
+inode_allocate (struct inode *inode, off_t offset, off_t size,
+                bool keep_size)
+{
+  off_t end = offset + size;
+
+  ASSERT (offset >= 0 && size >= 0);
+
+  if (inode->deny_write_cnt)
+    return false;
+
+  do
+    {
+      off_t chunk_end = end - offset > CHUNK_SIZE ? offset + CHUNK_SIZE : end;
+      if (!allocate_chunk (inode, offset, chunk_end, keep_size))
+        return false;
+      offset = chunk_end;
+    }
+  while (offset < end);
+  return true;
+}
+
+/* Does the work of inode_allocate() for the bytes of INODE from
+   OFFSET to END, inside a single journal handle. */
+static bool
+allocate_chunk (struct inode *inode, off_t offset, off_t end, bool keep_size)
+{
+  bool success = true;
+
+  journal_begin ();
+  rwlock_acquire_write (&inode->rwlock);
+
+  allocate_delayed (inode);
+  if (inode->data.magic == INLINE_MAGIC && end > (off_t) INLINE_SIZE)
+    success = move_inline (inode);
+  if (success && inode->data.magic != INLINE_MAGIC)
+    {
+      off_t length = inode_length (inode);
+      size_t end_idx = DIV_ROUND_UP (end, DISK_SECTOR_SIZE);
+      size_t idx;
+
+      if (!keep_size)
+        zero_tail (inode, ROUND_UP (end, DISK_SECTOR_SIZE));
+      for (idx = offset / DISK_SECTOR_SIZE; idx < end_idx; idx++)
+        if (lookup_block (&inode->data, idx) == 0)
+          {
+            bool in_file = (off_t) idx * DISK_SECTOR_SIZE < length;
+            if (allocate_blocks (inode, idx, end_idx - idx,
+                                 in_file || !keep_size) == 0)
+              {
+                success = false;
+                break;
+              }
+          }
+    }
+  if (success && !keep_size && end > inode->data.length)
+    inode->data.length = end;
+  journal_write (inode->sector, &inode->data);
+
+  rwlock_release_write (&inode->rwlock);
+  journal_end ();
+
+  return success;
+}
+
+/* Writes INODE's cached data back to disk and commits the
+   journal, which makes its metadata durable. */
+void
+inode_flush (struct inode *inode)
+{
+  size_t sectors = bytes_to_sectors (inode_length (inode));
+  size_t i;
+
+  if (!is_metadata (inode))
+    {
+      flush_delayed (inode, 0);
+      rwlock_acquire_read (&inode->rwlock);
+      for (i = 0; i < sectors; i++)
+        {
+          disk_sector_t sector = lookup_block (&inode->data, i);
+          if (sector != 0)
+            cache_flush_sector (sector);
+        }
+      rwlock_release_read (&inode->rwlock);
+    }
+  journal_commit ();
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
 inode_deny_write (struct inode *inode) 
 {
+  lock_acquire (&inode->lock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  lock_release (&inode->lock);
 }
 
 /* Re-enables writes to INODE.
@@ -377,9 +1947,11 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  lock_acquire (&inode->lock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  lock_release (&inode->lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -1,21 +1,38 @@
 #ifndef FILESYS_INODE_H
 #define FILESYS_INODE_H
 
+#include <iovec.h>
 #include <stdbool.h>
 #include "filesys/off_t.h"
 #include "devices/disk.h"
 
 struct bitmap;
 
+/* If true, new files use the extent layout. */
+extern bool inode_use_extents;
+
 void inode_init (void);
-bool inode_create (disk_sector_t, off_t);
+bool inode_create (disk_sector_t, off_t, bool is_dir);
 struct inode *inode_open (disk_sector_t);
 struct inode *inode_reopen (struct inode *);
 disk_sector_t inode_get_inumber (const struct inode *);
 void inode_close (struct inode *);
+void inode_free_removed (void);
 void inode_remove (struct inode *);
+bool inode_is_removed (const struct inode *);
+bool inode_is_dir (const struct inode *);
+void inode_lock (struct inode *);
+void inode_unlock (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_readv_at (struct inode *, const struct iovec *, int iovcnt,
+                      off_t offset);
+off_t inode_writev_at (struct inode *, const struct iovec *, int iovcnt,
+                       off_t offset);
+bool inode_allocate (struct inode *, off_t offset, off_t size,
+                     bool keep_size);
+void inode_flush (struct inode *);
+void inode_sync (void);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
@@ -0,0 +1,604 @@
+#include "filesys/journal.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* The journal makes updates to file system metadata atomic, so
+   that a crash leaves every inode, indirect block, directory and
+   the free map as it was either before or after each operation.
+
+   File data is not journaled.  Metadata is written with
+   journal_write(), which puts it into the buffer cache marked as
+   "logged", so that it stays in memory.  Each operation that
+   writes metadata runs inside a handle, between journal_begin()
+   and journal_end().  The metadata written by all handles since
+   the last commit forms the running transaction.
+
+   A commit waits for the open handles to end, so that it never
+   catches an operation halfway.  While it waits, no new handles
+   start.  It then appends one record to the log, holding the
+   current contents of every logged sector, and releases those
+   sectors to be written back to their home locations as usual.
+   Commits happen periodically in the journal thread, when the
+   running transaction grows large, and on sync and fsync.  A
+   single commit thus makes many operations durable with one
+   sequential write.
+
+   The journal occupies the sector JOURNAL_SECTOR, which holds
+   the header, and the JOURNAL_SIZE sectors after it, which hold
+   the log.  A record is a descriptor block listing the home
+   sectors of the blocks that follow it, those blocks, zero or
+   more revoke blocks and a commit block.  All of them carry the
+   record's sequence number.  A record counts only if its commit
+   block is on disk.
+
+   The header gives the position and sequence number of the
+   oldest record that may still be needed.  At startup,
+   journal_init() replays every complete record from there on, in
+   order, copying its blocks to their home locations.
+
+   When a commit leaves less room in the log than the longest
+   possible record, a checkpoint writes all cached sectors back to
+   their home locations, which makes the records in the log
+   unnecessary, and starts the log over at its beginning.  It runs
+   right after the commit, while no sector is logged.  A logged
+   sector's last committed contents may be only in the log until
+   its next record commits, so the log must not be cleared before
+   then.
+
+   A metadata sector that is freed and then reused for file data
+   must not be overwritten by replaying an older record.  Freeing
+   a sector that is in the log since the last checkpoint revokes
+   it.  Replay skips a block if the same record or a later one
+   revokes its sector.  Logging the sector again cancels a revoke
+   by the running transaction. */
+
+/* Magic numbers of the journal header and of log blocks. */
+#define HEADER_MAGIC 0x4a524e4c         /* Journal header. */
+#define DESC_MAGIC 0x4a444553           /* Descriptor block. */
+#define REVOKE_MAGIC 0x4a525643         /* Revoke block. */
+#define COMMIT_MAGIC 0x4a434d54         /* Commit block. */
+
+/* First sector of the log. */
+#define LOG_START (JOURNAL_SECTOR + 1)
+
+/* On-disk journal header.
+   Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    uint32_t magic;                     /* HEADER_MAGIC. */
+    uint32_t start;                     /* Log position of first record. */
+    uint32_t seq;                       /* Sequence number of that record. */
+    uint32_t unused[125];               /* Not used. */
+  };
+
+/* Number of sector numbers in a descriptor or revoke block. */
+#define BLOCK_SECTOR_CNT ((DISK_SECTOR_SIZE - 3 * sizeof (uint32_t)) \
+                          / sizeof (disk_sector_t))
+
+/* A descriptor, revoke or commit block.
+   Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct log_block
+  {
+    uint32_t magic;                     /* DESC_MAGIC, REVOKE_MAGIC or
+                                           COMMIT_MAGIC. */
+    uint32_t seq;                       /* Record's sequence number. */
+    uint32_t cnt;                       /* Number of SECTORS in use. */
+    disk_sector_t sectors[BLOCK_SECTOR_CNT];    /* Home sectors of the
+                                                   blocks that follow, or
+                                                   revoked sectors. */
+  };
+
+/* Largest number of sectors that a handle logs.  A handle starts
+   only if every open handle, itself included, could still log
+   this many sectors without exceeding CACHE_LOGGED_MAX.  Only
+   sectors that were not logged yet count, since writing a logged
+   sector again takes no more room in the cache.  Large operations
+   are split into several handles to stay within it (see
+   inode_writev_at() and journal_extend()). */
+#define HANDLE_MAX 8
+
+/* Longest possible record: a descriptor, the logged sectors, one
+   revoke block for each BLOCK_SECTOR_CNT sectors that can have a
+   copy in the log, and a commit block. */
+#define RECORD_MAX (1 + CACHE_LOGGED_MAX                                 \
+                    + DIV_ROUND_UP (JOURNAL_SIZE + CACHE_LOGGED_MAX,     \
+                                    BLOCK_SECTOR_CNT)                    \
+                    + 1)
+
+/* Number of logged sectors that a commit copies to the log with
+   a single disk command. */
+#define LOG_BATCH 8
+
+/* How often the journal thread commits, in timer ticks. */
+#define COMMIT_PERIOD (TIMER_FREQ / 4)
+
+/* True once the journal has been replayed.  Until then, and
+   while formatting, metadata is written directly. */
+static bool active;
+
+static struct lock journal_lock;        /* Protects the variables below. */
+static struct condition handle_ended;   /* Broadcast when a handle
+                                           ends. */
+static struct condition commit_done;    /* Signaled after a commit. */
+static int handle_cnt;                  /* Number of open handles. */
+static bool committing;                 /* Is a commit in progress? */
+static uint32_t next_seq;               /* Sequence number of next record. */
+static size_t head;                     /* Log position of next record. */
+
+/* Sectors with a copy in the log since the last checkpoint, or
+   in the running transaction. */
+static struct bitmap *in_log;
+
+/* Sectors revoked by the running transaction. */
+static struct bitmap *revoked;
+static size_t revoke_cnt;
+
+/* Buffers used by commits and replay, under journal_lock. */
+static struct log_block desc_block;
+static struct log_block aux_block;
+static uint8_t data_block[DISK_SECTOR_SIZE];
+static uint8_t data_blocks[LOG_BATCH][DISK_SECTOR_SIZE];
+
+static thread_func journal_daemon NO_RETURN;
+static void write_header (size_t start, uint32_t seq);
+static void write_log (size_t pos, const void *blocks, size_t cnt);
+static void replay (void);
+static void write_record (void);
+
+/* Creates an empty journal.  Called when formatting. */
+void
+journal_create (void)
+{
+  size_t i;
+
+  /* Clear the log, so that no record of an earlier file system
+     can be mistaken for one of this one. */
+  memset (data_blocks, 0, sizeof data_blocks);
+  for (i = 0; i < JOURNAL_SIZE; i += LOG_BATCH)
+    write_log (i, data_blocks,
+               JOURNAL_SIZE - i < LOG_BATCH ? JOURNAL_SIZE - i : LOG_BATCH);
+  write_header (0, 1);
+}
+
+/* Initializes the journal module and replays the log, so that
+   all metadata on disk is as of the last commit. */
+void
+journal_init (void)
+{
+  ASSERT (sizeof (struct journal_header) == DISK_SECTOR_SIZE);
+  ASSERT (sizeof (struct log_block) == DISK_SECTOR_SIZE);
+
+  lock_init (&journal_lock);
+  cond_init (&handle_ended);
+  cond_init (&commit_done);
+  handle_cnt = 0;
+  committing = false;
+
+  in_log = bitmap_create (disk_size (filesys_disk));
+  revoked = bitmap_create (disk_size (filesys_disk));
+  if (in_log == NULL || revoked == NULL)
+    PANIC ("journal bitmap creation failed--disk is too large");
+  revoke_cnt = 0;
+
+  replay ();
+  active = true;
+  thread_create ("journal", PRI_DEFAULT, journal_daemon, NULL);
+}
+
+/* Commits the running transaction and checkpoints, leaving the
+   log empty.  Called when the file system shuts down. */
+void
+journal_done (void)
+{
+  if (!active)
+    return;
+  journal_commit ();
+
+  lock_acquire (&journal_lock);
+  cache_flush ();
+  write_header (head, next_seq);
+  active = false;
+  lock_release (&journal_lock);
+}
+
+/* Starts a handle.  The metadata written by the running thread
+   until the matching journal_end() is committed atomically.
+   Handles nest.  A thread must start its outermost handle before
+   acquiring any file system lock, because starting it may wait
+   for other handles to end or for a commit.  A handle, with all
+   the handles nested in it, may log at most HANDLE_MAX
+   sectors. */
+void
+journal_begin (void)
+{
+  struct thread *t = thread_current ();
+
+  if (!active)
+    return;
+  if (t->journal_depth > 0)
+    {
+      t->journal_depth++;
+      return;
+    }
+
+  lock_acquire (&journal_lock);
+  for (;;)
+    {
+      size_t logged;
+
+      while (committing)
+        cond_wait (&commit_done, &journal_lock);
+      logged = cache_logged_cnt ();
+      if (logged + (handle_cnt + 1) * HANDLE_MAX <= CACHE_LOGGED_MAX)
+        break;
+      if (logged + HANDLE_MAX > CACHE_LOGGED_MAX)
+        {
+          /* Only a commit makes room. */
+          lock_release (&journal_lock);
+          journal_commit ();
+          lock_acquire (&journal_lock);
+        }
+      else
+        cond_wait (&handle_ended, &journal_lock);
+    }
+  handle_cnt++;
+  lock_release (&journal_lock);
+  t->journal_depth = 1;
+  t->journal_logged = 0;
+}
+
+/* Ends a handle started by journal_begin(). */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+
+  if (!active)
+    return;
+  ASSERT (t->journal_depth > 0);
+  if (--t->journal_depth > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  handle_cnt--;
+  cond_broadcast (&handle_ended, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/* Makes sure that the running thread's handle may log CNT more
+   sectors.  If it may not, ends the handle and starts a new one,
+   so that what was written so far commits apart from what
+   follows.  For operations too long for a single handle, which
+   must leave the file system consistent at each call.  The handle
+   must not be nested, and the caller must hold no file system
+   lock, for the same reason as in journal_begin(). */
+void
+journal_extend (size_t cnt)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (cnt <= HANDLE_MAX);
+  if (!active)
+    return;
+  ASSERT (t->journal_depth == 1);
+  if (t->journal_logged + cnt > HANDLE_MAX)
+    {
+      journal_end ();
+      journal_begin ();
+    }
+}
+
+/* Returns true if the running thread is inside a handle. */
+bool
+journal_in_handle (void)
+{
+  return thread_current ()->journal_depth > 0;
+}
+
+/* Writes metadata sector SECTOR from BUFFER, which must contain
+   DISK_SECTOR_SIZE bytes. */
+void
+journal_write (disk_sector_t sector, const void *buffer)
+{
+  journal_write_at (sector, buffer, DISK_SECTOR_SIZE, 0);
+}
+
+/* Writes SIZE bytes from BUFFER into metadata sector SECTOR,
+   starting at byte OFFSET within the sector.  Must be called
+   inside a handle. */
+void
+journal_write_at (disk_sector_t sector, const void *buffer,
+                  off_t size, off_t offset)
+{
+  struct thread *t = thread_current ();
+
+  if (!active)
+    {
+      cache_write_at (sector, buffer, size, offset);
+      return;
+    }
+  ASSERT (t->journal_depth > 0);
+
+  if (cache_write_logged_at (sector, buffer, size, offset))
+    {
+      t->journal_logged++;
+      ASSERT (t->journal_logged <= HANDLE_MAX);
+    }
+
+  lock_acquire (&journal_lock);
+  bitmap_mark (in_log, sector);
+  if (bitmap_test (revoked, sector))
+    {
+      bitmap_reset (revoked, sector);
+      revoke_cnt--;
+    }
+  lock_release (&journal_lock);
+}
+
+/* Notes that the CNT sectors starting at SECTOR are being freed,
+   so that replay does not write old metadata over whatever they
+   are used for next.  Must be called inside a handle. */
+void
+journal_revoke (disk_sector_t sector, size_t cnt)
+{
+  size_t i;
+
+  if (!active)
+    return;
+  ASSERT (thread_current ()->journal_depth > 0);
+
+  lock_acquire (&journal_lock);
+  for (i = 0; i < cnt; i++)
+    if (bitmap_test (in_log, sector + i))
+      {
+        bitmap_reset (in_log, sector + i);
+        if (!bitmap_test (revoked, sector + i))
+          {
+            bitmap_mark (revoked, sector + i);
+            revoke_cnt++;
+          }
+      }
+  lock_release (&journal_lock);
+}
+
+/* Commits the running transaction, making all metadata written
+   by handles that have ended durable.  Must not be called inside
+   a handle. */
+void
+journal_commit (void)
+{
+  if (!active)
+    return;
+  ASSERT (thread_current ()->journal_depth == 0);
+
+  lock_acquire (&journal_lock);
+  while (committing)
+    cond_wait (&commit_done, &journal_lock);
+  committing = true;
+  while (handle_cnt > 0)
+    cond_wait (&handle_ended, &journal_lock);
+
+  write_record ();
+
+  committing = false;
+  cond_broadcast (&commit_done, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/* Commits periodically, for as long as the system runs. */
+static void
+journal_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (COMMIT_PERIOD);
+      journal_commit ();
+    }
+}
+
+/* Writes the journal header, with the first record at log
+   position START and sequence number SEQ. */
+static void
+write_header (size_t start, uint32_t seq)
+{
+  struct journal_header *h = (struct journal_header *) data_block;
+
+  memset (h, 0, sizeof *h);
+  h->magic = HEADER_MAGIC;
+  h->start = start;
+  h->seq = seq;
+  disk_write (filesys_disk, JOURNAL_SECTOR, h);
+}
+
+/* Reads log position POS into BLOCK. */
+static void
+read_log (size_t pos, void *block)
+{
+  ASSERT (pos < JOURNAL_SIZE);
+  disk_read (filesys_disk, LOG_START + pos, block);
+}
+
+/* Writes the CNT sectors in BLOCKS to the log, starting at log
+   position POS. */
+static void
+write_log (size_t pos, const void *blocks, size_t cnt)
+{
+  ASSERT (pos + cnt <= JOURNAL_SIZE);
+  disk_write_multi (filesys_disk, LOG_START + pos, blocks, cnt);
+}
+
+/* Checks for a complete record with sequence number SEQ at log
+   position POS.  If there is one, reads its descriptor into
+   desc_block and returns its length in sectors.  Otherwise,
+   returns 0. */
+static size_t
+scan_record (size_t pos, uint32_t seq)
+{
+  size_t len;
+
+  read_log (pos, &desc_block);
+  if (desc_block.magic != DESC_MAGIC || desc_block.seq != seq
+      || desc_block.cnt > BLOCK_SECTOR_CNT)
+    return 0;
+
+  for (len = 1 + desc_block.cnt; pos + len < JOURNAL_SIZE; len++)
+    {
+      read_log (pos + len, &aux_block);
+      if (aux_block.seq != seq)
+        break;
+      if (aux_block.magic == COMMIT_MAGIC)
+        return len + 1;
+      if (aux_block.magic != REVOKE_MAGIC
+          || aux_block.cnt > BLOCK_SECTOR_CNT)
+        break;
+    }
+  return 0;
+}
+
+/* Copies every complete record in the log, oldest first, to the
+   home locations of its blocks, and empties the log. */
+static void
+replay (void)
+{
+  struct journal_header *h = (struct journal_header *) data_block;
+  size_t sector_cnt = disk_size (filesys_disk);
+  uint32_t *revoke_seq;
+  uint32_t first_seq, seq;
+  size_t start, pos, len, i, j;
+
+  disk_read (filesys_disk, JOURNAL_SECTOR, h);
+  if (h->magic != HEADER_MAGIC || h->start >= JOURNAL_SIZE)
+    PANIC ("file system has no journal--reformat it");
+  start = h->start;
+  first_seq = h->seq;
+
+  /* For each sector, the sequence number of the last record that
+     revokes it, or 0. */
+  revoke_seq = calloc (sector_cnt, sizeof *revoke_seq);
+  if (revoke_seq == NULL)
+    PANIC ("out of memory replaying journal");
+
+  /* Find the revoked sectors. */
+  for (pos = start, seq = first_seq;
+       (len = scan_record (pos, seq)) != 0; pos += len, seq++)
+    for (i = 1 + desc_block.cnt; i < len - 1; i++)
+      {
+        read_log (pos + i, &aux_block);
+        for (j = 0; j < aux_block.cnt; j++)
+          if (aux_block.sectors[j] < sector_cnt)
+            revoke_seq[aux_block.sectors[j]] = seq;
+      }
+
+  /* Copy the blocks that were not revoked. */
+  for (pos = start, seq = first_seq;
+       (len = scan_record (pos, seq)) != 0; pos += len, seq++)
+    for (i = 0; i < desc_block.cnt; i++)
+      {
+        disk_sector_t sector = desc_block.sectors[i];
+        if (sector < sector_cnt && revoke_seq[sector] < seq)
+          {
+            read_log (pos + 1 + i, data_block);
+            cache_write (sector, data_block);
+          }
+      }
+  free (revoke_seq);
+
+  /* Start over with an empty log.  Any incomplete record left at
+     POS has sequence number SEQ, so the new records start past
+     it. */
+  cache_flush ();
+  head = 0;
+  next_seq = seq + 1;
+  write_header (head, next_seq);
+}
+
+/* Writes back all cached sectors, so that the records in the log
+   are no longer needed, and starts the log over at its
+   beginning.  Must be called right after a commit, while no
+   sector is logged, so that every cached sector holds committed
+   contents. */
+static void
+checkpoint (void)
+{
+  ASSERT (cache_logged_cnt () == 0);
+
+  cache_flush ();
+  head = 0;
+  write_header (head, next_seq);
+  bitmap_set_all (in_log, false);
+}
+
+/* Appends the running transaction to the log as a new record and
+   starts a new transaction.  The caller must hold journal_lock,
+   and there must be no open handles. */
+static void
+write_record (void)
+{
+  size_t cnt, revoke_blocks, len, pos, i, j;
+  size_t sector;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  ASSERT (handle_cnt == 0);
+
+  cnt = cache_logged (desc_block.sectors, BLOCK_SECTOR_CNT);
+  if (cnt == 0 && revoke_cnt == 0)
+    return;
+  revoke_blocks = DIV_ROUND_UP (revoke_cnt, BLOCK_SECTOR_CNT);
+  len = 1 + cnt + revoke_blocks + 1;
+  ASSERT (len <= RECORD_MAX && head + len <= JOURNAL_SIZE);
+
+  /* Descriptor and copies of the logged sectors. */
+  desc_block.magic = DESC_MAGIC;
+  desc_block.seq = next_seq;
+  desc_block.cnt = cnt;
+  write_log (head, &desc_block, 1);
+  for (i = 0; i < cnt; i += j)
+    {
+      for (j = 0; j < LOG_BATCH && i + j < cnt; j++)
+        cache_read (desc_block.sectors[i + j], data_blocks[j]);
+      write_log (head + 1 + i, data_blocks, j);
+    }
+  pos = head + 1 + cnt;
+
+  /* Revoke blocks. */
+  aux_block.magic = REVOKE_MAGIC;
+  aux_block.seq = next_seq;
+  aux_block.cnt = 0;
+  for (sector = bitmap_scan (revoked, 0, 1, true); sector != BITMAP_ERROR;
+       sector = bitmap_scan (revoked, sector + 1, 1, true))
+    {
+      aux_block.sectors[aux_block.cnt++] = sector;
+      if (aux_block.cnt == BLOCK_SECTOR_CNT)
+        {
+          write_log (pos++, &aux_block, 1);
+          aux_block.cnt = 0;
+        }
+    }
+  if (aux_block.cnt > 0)
+    write_log (pos++, &aux_block, 1);
+
+  /* Once the commit block is on disk, the record counts. */
+  aux_block.magic = COMMIT_MAGIC;
+  aux_block.cnt = 0;
+  write_log (pos++, &aux_block, 1);
+  ASSERT (pos == head + len);
+
+  cache_unlog ();
+  bitmap_set_all (revoked, false);
+  revoke_cnt = 0;
+  head += len;
+  next_seq++;
+
+  /* Make sure that the next record fits. */
+  if (JOURNAL_SIZE - head < RECORD_MAX)
+    checkpoint ();
+}
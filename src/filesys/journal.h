@@ -0,0 +1,25 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "devices/disk.h"
+
+/* Number of log sectors that follow the journal header. */
+#define JOURNAL_SIZE 128
+
+void journal_create (void);
+void journal_init (void);
+void journal_done (void);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_extend (size_t cnt);
+bool journal_in_handle (void);
+void journal_write (disk_sector_t, const void *);
+void journal_write_at (disk_sector_t, const void *, off_t size, off_t offset);
+void journal_revoke (disk_sector_t, size_t cnt);
+void journal_commit (void);
+
+#endif /* filesys/journal.h */
@@ -0,0 +1,18 @@
+#ifndef __LIB_DIRENT_H
+#define __LIB_DIRENT_H
+
+#include <stdbool.h>
+
+/* Maximum length of a name in a struct dirent. */
+#define DIRENT_NAME_MAX 14
+
+/* A directory entry, as returned by the getdents() system
+   call. */
+struct dirent
+  {
+    int d_ino;                          /* Inode number. */
+    bool d_is_dir;                      /* Is it a directory? */
+    char d_name[DIRENT_NAME_MAX + 1];   /* Null-terminated name. */
+  };
+
+#endif /* lib/dirent.h */
@@ -359,6 +359,27 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the elements of B that hold bits START through
+   START + CNT - 1 to FILE, at the offsets where bitmap_write()
+   puts them.  Return true if successful, false otherwise. */
+bool
+bitmap_write_range (const struct bitmap *b, struct file *file,
+                    size_t start, size_t cnt)
+{
+  off_t ofs, size;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+  ASSERT (cnt <= b->bit_cnt - start);
+
+  if (cnt == 0)
+    return true;
+  ofs = elem_idx (start) * sizeof (elem_type);
+  size = byte_cnt (start + cnt) - ofs;
+  return file_write_at (file, (const uint8_t *) b->bits + ofs,
+                        size, ofs) == size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -28,7 +28,28 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Buffer cache. */
+    SYS_SYNC,                   /* Write all buffered data to disk. */
+    SYS_FSYNC,                  /* Write a file's buffered data to disk. */
+
+    /* Positional I/O. */
+    SYS_PREAD,                  /* Read from a file at an offset. */
+    SYS_PWRITE,                 /* Write to a file at an offset. */
+
+    /* Scatter/gather I/O. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write several buffers to a file. */
+
+    /* In-kernel copy. */
+    SYS_COPY_FILE_RANGE,        /* Copy data from one file to another. */
+
+    /* Space reservation. */
+    SYS_FALLOCATE,              /* Reserve disk space for a file. */
+
+    /* Batched directory listing. */
+    SYS_GETDENTS                /* Reads several directory entries. */
   };
 
 #endif /* lib/syscall-nr.h */
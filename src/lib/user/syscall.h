@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <dirent.h>
+#include <iovec.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -15,6 +17,9 @@ typedef int mapid_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* Flag for fallocate(): do not change the size of the file. */
+#define FALLOC_KEEP_SIZE 1
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -44,5 +49,24 @@ bool mkdir (const char *dir);
 bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
+int getdents (int fd, struct dirent *entries, unsigned cnt);
+
+/* Buffer cache. */
+void sync (void);
+bool fsync (int fd);
+
+/* Positional I/O. */
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+
+/* Scatter/gather I/O. */
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+
+/* In-kernel copy. */
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+
+/* Space reservation. */
+bool fallocate (int fd, int mode, unsigned offset, unsigned length);
 
 #endif /* lib/user/syscall.h */
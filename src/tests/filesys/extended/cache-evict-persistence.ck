@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($a) = random_bytes (51200);
+my ($b) = random_bytes (51200);
+substr ($a, 20000, 9000) = random_bytes (9000);
+check_archive ({"a" => [$a], "b" => [$b]});
+pass;
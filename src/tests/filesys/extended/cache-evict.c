@@ -0,0 +1,65 @@
+/* Grows two files together until they are much larger than the
+   buffer cache, so that dirty sectors of one file are evicted to
+   make room for the other, then rewrites a stretch in the middle
+   of the first file and checks that both read back intact. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (100 * 512)
+#define CHUNK_SIZE 700
+#define PATCH_OFS 20000
+#define PATCH_SIZE 9000
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+static char patch[PATCH_SIZE];
+
+static void
+write_chunk (const char *file_name, int fd, const char *buf, size_t ofs)
+{
+  size_t size = FILE_SIZE - ofs < CHUNK_SIZE ? FILE_SIZE - ofs : CHUNK_SIZE;
+  if (write (fd, buf + ofs, size) != (int) size)
+    fail ("write %zu bytes at offset %zu in \"%s\" failed",
+          size, ofs, file_name);
+}
+
+void
+test_main (void)
+{
+  int fd_a, fd_b;
+  size_t ofs;
+
+  random_init (0);
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+  random_bytes (patch, sizeof patch);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((fd_a = open ("a")) > 1, "open \"a\"");
+  CHECK ((fd_b = open ("b")) > 1, "open \"b\"");
+
+  msg ("write \"a\" and \"b\" alternately");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      write_chunk ("a", fd_a, buf_a, ofs);
+      write_chunk ("b", fd_b, buf_b, ofs);
+    }
+
+  msg ("rewrite the middle of \"a\"");
+  seek (fd_a, PATCH_OFS);
+  CHECK (write (fd_a, patch, PATCH_SIZE) == PATCH_SIZE,
+         "write %d bytes at offset %d in \"a\"", PATCH_SIZE, PATCH_OFS);
+  memcpy (buf_a + PATCH_OFS, patch, PATCH_SIZE);
+
+  msg ("close \"a\"");
+  close (fd_a);
+  msg ("close \"b\"");
+  close (fd_b);
+
+  check_file ("a", buf_a, FILE_SIZE);
+  check_file ("b", buf_b, FILE_SIZE);
+}
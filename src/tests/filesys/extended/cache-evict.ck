@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-evict) begin
+(cache-evict) create "a"
+(cache-evict) create "b"
+(cache-evict) open "a"
+(cache-evict) open "b"
+(cache-evict) write "a" and "b" alternately
+(cache-evict) rewrite the middle of "a"
+(cache-evict) write 9000 bytes at offset 20000 in "a"
+(cache-evict) close "a"
+(cache-evict) close "b"
+(cache-evict) open "a" for verification
+(cache-evict) verified contents of "a"
+(cache-evict) close "a"
+(cache-evict) open "b" for verification
+(cache-evict) verified contents of "b"
+(cache-evict) close "b"
+(cache-evict) end
+EOF
+pass;
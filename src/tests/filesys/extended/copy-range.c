@@ -0,0 +1,45 @@
+/* Copies a file with copy_file_range(), in a call that copies
+   part of it and then one that asks for more than is left, and
+   checks the copy. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 9999
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int in_fd, out_fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK ((in_fd = open ("a")) > 1, "open \"a\"");
+  CHECK (write (in_fd, buf, FILE_SIZE) == FILE_SIZE, "write \"a\"");
+  msg ("seek \"a\" to 0");
+  seek (in_fd, 0);
+
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((out_fd = open ("b")) > 1, "open \"b\"");
+  CHECK (copy_file_range (in_fd, out_fd, 4000) == 4000,
+         "copy 4000 bytes from \"a\" to \"b\"");
+  CHECK (copy_file_range (in_fd, out_fd, 8000) == FILE_SIZE - 4000,
+         "copy the rest of \"a\" to \"b\"");
+  CHECK (copy_file_range (in_fd, out_fd, 100) == 0,
+         "copy at end of \"a\"");
+  CHECK (tell (out_fd) == FILE_SIZE, "tell \"b\"");
+  CHECK (copy_file_range (in_fd, in_fd, 100) == -1,
+         "copy \"a\" to itself");
+
+  msg ("close \"a\"");
+  close (in_fd);
+  msg ("close \"b\"");
+  close (out_fd);
+  check_file ("a", buf, FILE_SIZE);
+  check_file ("b", buf, FILE_SIZE);
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(copy-range) begin
+(copy-range) create "a"
+(copy-range) open "a"
+(copy-range) write "a"
+(copy-range) seek "a" to 0
+(copy-range) create "b"
+(copy-range) open "b"
+(copy-range) copy 4000 bytes from "a" to "b"
+(copy-range) copy the rest of "a" to "b"
+(copy-range) copy at end of "a"
+(copy-range) tell "b"
+(copy-range) copy "a" to itself
+(copy-range) close "a"
+(copy-range) close "b"
+(copy-range) open "a" for verification
+(copy-range) verified contents of "a"
+(copy-range) close "a"
+(copy-range) open "b" for verification
+(copy-range) verified contents of "b"
+(copy-range) close "b"
+(copy-range) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (%fs) = ("x" => ["\0" x 7]);
+$fs{"n$_"} = [""] foreach 0...29;
+check_archive (\%fs);
+pass;
@@ -0,0 +1,56 @@
+/* Looks up names that do not exist, then creates, removes and
+   recreates them, checking that every lookup finds the latest
+   file by that name rather than an earlier answer. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define NAME_CNT 30
+
+void
+test_main (void)
+{
+  char name[16];
+  int fd, old_fd;
+  int i;
+
+  CHECK (open ("x") == -1, "open \"x\" (must fail)");
+  CHECK (create ("x", 0), "create \"x\"");
+  CHECK ((fd = open ("x")) > 1, "open \"x\"");
+  CHECK (filesize (fd) == 0, "filesize \"x\" is 0");
+  close (fd);
+
+  CHECK (remove ("x"), "remove \"x\"");
+  CHECK (open ("x") == -1, "open \"x\" (must fail)");
+  CHECK (create ("x", 5), "create \"x\" with 5 bytes");
+  CHECK ((old_fd = open ("x")) > 1, "open \"x\"");
+  CHECK (filesize (old_fd) == 5, "filesize \"x\" is 5");
+
+  CHECK (remove ("x"), "remove \"x\" while open");
+  CHECK (open ("x") == -1, "open \"x\" (must fail)");
+  CHECK (create ("x", 7), "create \"x\" with 7 bytes");
+  CHECK ((fd = open ("x")) > 1, "open \"x\"");
+  CHECK (filesize (fd) == 7, "filesize \"x\" is 7");
+  CHECK (filesize (old_fd) == 5, "filesize of removed \"x\" is 5");
+  close (fd);
+  close (old_fd);
+
+  msg ("look up %d missing names, then create them", NAME_CNT);
+  for (i = 0; i < NAME_CNT; i++)
+    {
+      snprintf (name, sizeof name, "n%d", i);
+      if (open (name) != -1)
+        fail ("open \"%s\" succeeded before create", name);
+    }
+  for (i = 0; i < NAME_CNT; i++)
+    {
+      snprintf (name, sizeof name, "n%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed after create", name);
+      close (fd);
+    }
+}
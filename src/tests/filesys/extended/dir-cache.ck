@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-cache) begin
+(dir-cache) open "x" (must fail)
+(dir-cache) create "x"
+(dir-cache) open "x"
+(dir-cache) filesize "x" is 0
+(dir-cache) remove "x"
+(dir-cache) open "x" (must fail)
+(dir-cache) create "x" with 5 bytes
+(dir-cache) open "x"
+(dir-cache) filesize "x" is 5
+(dir-cache) remove "x" while open
+(dir-cache) open "x" (must fail)
+(dir-cache) create "x" with 7 bytes
+(dir-cache) open "x"
+(dir-cache) filesize "x" is 7
+(dir-cache) filesize of removed "x" is 5
+(dir-cache) look up 30 missing names, then create them
+(dir-cache) end
+EOF
+pass;
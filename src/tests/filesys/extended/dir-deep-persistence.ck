@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($tree) = {"file" => ["deep"]};
+$tree = {"d$_" => $tree} foreach reverse 0...11;
+check_archive ($tree);
+pass;
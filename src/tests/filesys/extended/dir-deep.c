@@ -0,0 +1,63 @@
+/* Builds a chain of nested directories by absolute path, then
+   reaches a file at the bottom through absolute paths, relative
+   paths from several working directories, and paths that climb
+   back up with "..". */
+
+#include <string.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DEPTH 12
+
+static void
+check_contents (const char *path)
+{
+  char block[16];
+  int fd;
+
+  CHECK ((fd = open (path)) > 1, "open \"%s\"", path);
+  CHECK (read (fd, block, sizeof block) == 4 && !memcmp (block, "deep", 4),
+         "read \"%s\"", path);
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  char path[128];
+  size_t len = 0;
+  int fd;
+  int i;
+
+  msg ("mkdir %d nested directories", DEPTH);
+  quiet = true;
+  for (i = 0; i < DEPTH; i++)
+    {
+      len += snprintf (path + len, sizeof path - len, "/d%d", i);
+      CHECK (mkdir (path), "mkdir \"%s\"", path);
+    }
+  quiet = false;
+
+  strlcat (path, "/file", sizeof path);
+  CHECK (create (path, 0), "create \"%s\"", path);
+  CHECK ((fd = open (path)) > 1, "open \"%s\"", path);
+  CHECK (write (fd, "deep", 4) == 4, "write \"%s\"", path);
+  close (fd);
+
+  CHECK (chdir ("/d0/d1/d2/d3/d4/d5"), "chdir \"/d0/d1/d2/d3/d4/d5\"");
+  check_contents ("d6/d7/d8/d9/d10/d11/file");
+  CHECK (chdir ("d6/./d7/../d7/d8/d9/d10/d11"),
+         "chdir \"d6/./d7/../d7/d8/d9/d10/d11\"");
+  check_contents ("file");
+  check_contents ("../d11/./file");
+  check_contents ("../../../../../../../../../../../../../d0/d1/d2/d3/d4/d5/"
+                  "d6/d7/d8/d9/d10/d11/file");
+  CHECK (chdir ("../../.."), "chdir \"../../..\"");
+  check_contents ("d9/d10/d11/file");
+  CHECK (!chdir ("d9/d10/d11/file"), "chdir \"d9/d10/d11/file\" (must fail)");
+  CHECK (!mkdir ("d9/missing/d"), "mkdir \"d9/missing/d\" (must fail)");
+  CHECK (chdir ("/"), "chdir \"/\"");
+  check_contents ("d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/d10/d11/file");
+}
@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-deep) begin
+(dir-deep) mkdir 12 nested directories
+(dir-deep) create "/d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/d10/d11/file"
+(dir-deep) open "/d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/d10/d11/file"
+(dir-deep) write "/d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/d10/d11/file"
+(dir-deep) chdir "/d0/d1/d2/d3/d4/d5"
+(dir-deep) open "d6/d7/d8/d9/d10/d11/file"
+(dir-deep) read "d6/d7/d8/d9/d10/d11/file"
+(dir-deep) chdir "d6/./d7/../d7/d8/d9/d10/d11"
+(dir-deep) open "file"
+(dir-deep) read "file"
+(dir-deep) open "../d11/./file"
+(dir-deep) read "../d11/./file"
+(dir-deep) open "../../../../../../../../../../../../../d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/d10/d11/file"
+(dir-deep) read "../../../../../../../../../../../../../d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/d10/d11/file"
+(dir-deep) chdir "../../.."
+(dir-deep) open "d9/d10/d11/file"
+(dir-deep) read "d9/d10/d11/file"
+(dir-deep) chdir "d9/d10/d11/file" (must fail)
+(dir-deep) mkdir "d9/missing/d" (must fail)
+(dir-deep) chdir "/"
+(dir-deep) open "d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/d10/d11/file"
+(dir-deep) read "d0/d1/d2/d3/d4/d5/d6/d7/d8/d9/d10/d11/file"
+(dir-deep) end
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* Creates enough files in the root directory that it no longer
+   fits in a single block, looks each of them up by name, removes
+   every other one, and checks the lookups again afterward. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 150
+
+void
+test_main (void)
+{
+  char name[16];
+  int fd;
+  int i;
+
+  msg ("create %d files", FILE_CNT);
+  quiet = true;
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+    }
+  quiet = false;
+  CHECK (!create ("file0", 0), "create \"file0\" again (must fail)");
+
+  msg ("open each file by name");
+  quiet = true;
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      close (fd);
+    }
+  quiet = false;
+  CHECK (open ("file150") == -1, "open \"file150\" (must fail)");
+
+  msg ("remove every other file");
+  quiet = true;
+  for (i = 1; i < FILE_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      CHECK (remove (name), "remove \"%s\"", name);
+    }
+  quiet = false;
+
+  msg ("open each file by name again");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      fd = open (name);
+      if (i % 2 == 0 && fd < 2)
+        fail ("open \"%s\" failed", name);
+      if (i % 2 == 1 && fd != -1)
+        fail ("open \"%s\" succeeded after remove", name);
+      if (fd > 1)
+        close (fd);
+    }
+}
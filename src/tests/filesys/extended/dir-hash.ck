@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-hash) begin
+(dir-hash) create 150 files
+(dir-hash) create "file0" again (must fail)
+(dir-hash) open each file by name
+(dir-hash) open "file150" (must fail)
+(dir-hash) remove every other file
+(dir-hash) open each file by name again
+(dir-hash) end
+EOF
+pass;
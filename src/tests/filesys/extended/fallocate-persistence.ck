@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($data) = random_bytes (2000);
+check_archive ({"testfile" => ["\0" x 1000 . $data . "\0" x 3000]});
+pass;
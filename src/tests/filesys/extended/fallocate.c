@@ -0,0 +1,48 @@
+/* Reserves space in a file with fallocate(), with and without
+   FALLOC_KEEP_SIZE, and checks the file's size, that the new
+   space reads as zeros, and that allocating it again leaves data
+   written in the meantime alone. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 6000
+#define DATA_OFS 1000
+#define DATA_SIZE 2000
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "testfile";
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (fallocate (fd, FALLOC_KEEP_SIZE, 0, 20000),
+         "fallocate 20000 bytes of \"%s\", keeping its size", file_name);
+  CHECK (filesize (fd) == 0, "filesize \"%s\" is 0", file_name);
+  CHECK (fallocate (fd, 0, 0, FILE_SIZE),
+         "fallocate %d bytes of \"%s\"", FILE_SIZE, file_name);
+  CHECK (filesize (fd) == FILE_SIZE,
+         "filesize \"%s\" is %d", file_name, FILE_SIZE);
+  CHECK (!fallocate (fd, 2, 0, 1), "fallocate with a bad mode");
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, FILE_SIZE);
+
+  random_init (0);
+  random_bytes (buf + DATA_OFS, DATA_SIZE);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (pwrite (fd, buf + DATA_OFS, DATA_SIZE, DATA_OFS) == DATA_SIZE,
+         "pwrite \"%s\"", file_name);
+  CHECK (fallocate (fd, 0, 0, FILE_SIZE),
+         "fallocate %d bytes of \"%s\" again", FILE_SIZE, file_name);
+  CHECK (filesize (fd) == FILE_SIZE,
+         "filesize \"%s\" is %d", file_name, FILE_SIZE);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, FILE_SIZE);
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fallocate) begin
+(fallocate) create "testfile"
+(fallocate) open "testfile"
+(fallocate) fallocate 20000 bytes of "testfile", keeping its size
+(fallocate) filesize "testfile" is 0
+(fallocate) fallocate 6000 bytes of "testfile"
+(fallocate) filesize "testfile" is 6000
+(fallocate) fallocate with a bad mode
+(fallocate) close "testfile"
+(fallocate) open "testfile" for verification
+(fallocate) verified contents of "testfile"
+(fallocate) close "testfile"
+(fallocate) open "testfile"
+(fallocate) pwrite "testfile"
+(fallocate) fallocate 6000 bytes of "testfile" again
+(fallocate) filesize "testfile" is 6000
+(fallocate) close "testfile"
+(fallocate) open "testfile" for verification
+(fallocate) verified contents of "testfile"
+(fallocate) close "testfile"
+(fallocate) end
+EOF
+pass;
@@ -0,0 +1,75 @@
+/* Lists a directory with getdents(), a few entries at a time,
+   and checks that each entry comes back exactly once. */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 20
+
+void
+test_main (void) 
+{
+  struct dirent entries[3];
+  bool seen[FILE_CNT + 1];
+  char name[16];
+  int total = 0;
+  int fd;
+  int cnt;
+  int i;
+
+  CHECK (mkdir ("dir"), "mkdir \"dir\"");
+  msg ("create %d files in \"dir\"", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "dir/f%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\"", name);
+    }
+  CHECK (mkdir ("dir/sub"), "mkdir \"dir/sub\"");
+
+  CHECK ((fd = open ("dir")) > 1, "open \"dir\"");
+  msg ("getdents \"dir\"");
+  memset (seen, 0, sizeof seen);
+  while ((cnt = getdents (fd, entries, 3)) > 0)
+    for (i = 0; i < cnt; i++)
+      {
+        const struct dirent *e = &entries[i];
+        int idx;
+
+        if (!strcmp (e->d_name, "sub"))
+          {
+            idx = FILE_CNT;
+            if (!e->d_is_dir)
+              fail ("\"sub\" is not listed as a directory");
+          }
+        else
+          {
+            for (idx = 0; idx < FILE_CNT; idx++)
+              {
+                snprintf (name, sizeof name, "f%d", idx);
+                if (!strcmp (e->d_name, name))
+                  break;
+              }
+            if (idx == FILE_CNT)
+              fail ("getdents returned unexpected entry \"%s\"", e->d_name);
+            if (e->d_is_dir)
+              fail ("\"%s\" is listed as a directory", e->d_name);
+          }
+        if (seen[idx])
+          fail ("getdents returned \"%s\" twice", e->d_name);
+        seen[idx] = true;
+        total++;
+      }
+  if (cnt < 0)
+    fail ("getdents \"dir\" returned %d", cnt);
+  if (total != FILE_CNT + 1)
+    fail ("getdents returned %d entries, expected %d", total, FILE_CNT + 1);
+  CHECK (getdents (fd, entries, 3) == 0, "getdents at end of \"dir\"");
+
+  msg ("close \"dir\"");
+  close (fd);
+}
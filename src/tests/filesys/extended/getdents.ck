@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(getdents) begin
+(getdents) mkdir "dir"
+(getdents) create 20 files in "dir"
+(getdents) mkdir "dir/sub"
+(getdents) open "dir"
+(getdents) getdents "dir"
+(getdents) getdents at end of "dir"
+(getdents) close "dir"
+(getdents) end
+EOF
+pass;
@@ -0,0 +1,63 @@
+/* Writes every other sector of two files, alternating between
+   them, so that each file has more separate runs than fit in the
+   inode, then fills in the remaining sectors and checks both
+   files.  Make.tests runs this test with -extents. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 120
+#define FILE_SIZE (SECTOR_CNT * SECTOR_SIZE)
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+
+static void
+write_sector (const char *file_name, int fd, const char *buf, size_t sector)
+{
+  size_t ofs = sector * SECTOR_SIZE;
+
+  seek (fd, ofs);
+  if (write (fd, buf + ofs, SECTOR_SIZE) != SECTOR_SIZE)
+    fail ("write sector %zu of \"%s\" failed", sector, file_name);
+}
+
+void
+test_main (void)
+{
+  int fd_a, fd_b;
+  size_t sector;
+
+  random_init (0);
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((fd_a = open ("a")) > 1, "open \"a\"");
+  CHECK ((fd_b = open ("b")) > 1, "open \"b\"");
+
+  msg ("write even sectors of \"a\" and \"b\" alternately");
+  for (sector = 0; sector < SECTOR_CNT; sector += 2)
+    {
+      write_sector ("a", fd_a, buf_a, sector);
+      write_sector ("b", fd_b, buf_b, sector);
+    }
+
+  msg ("write odd sectors of \"a\" and \"b\" alternately");
+  for (sector = 1; sector < SECTOR_CNT; sector += 2)
+    {
+      write_sector ("a", fd_a, buf_a, sector);
+      write_sector ("b", fd_b, buf_b, sector);
+    }
+
+  msg ("close \"a\"");
+  close (fd_a);
+  msg ("close \"b\"");
+  close (fd_b);
+
+  check_file ("a", buf_a, FILE_SIZE);
+  check_file ("b", buf_b, FILE_SIZE);
+}
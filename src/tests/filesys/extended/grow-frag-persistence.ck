@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my (%fs);
+my (@small) = map (random_bytes (1024), 0...59);
+$fs{"s$_"} = [$small[$_]] foreach grep ($_ % 2, 0...59);
+$fs{'big'} = [random_bytes (150000)];
+check_archive (\%fs);
+pass;
@@ -0,0 +1,74 @@
+/* Fills the disk with small files and removes every other one,
+   leaving the free space in small pieces, then grows a file
+   through the direct, indirect and doubly indirect blocks of its
+   index and checks it and the remaining small files. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SMALL_CNT 60
+#define SMALL_SIZE 1024
+#define BIG_SIZE 150000
+#define CHUNK_SIZE 1000
+static char small[SMALL_CNT][SMALL_SIZE];
+static char big[BIG_SIZE];
+
+void
+test_main (void)
+{
+  char name[16];
+  size_t ofs;
+  int fd;
+  int i;
+
+  random_init (0);
+  random_bytes (small, sizeof small);
+  random_bytes (big, sizeof big);
+
+  msg ("create %d small files", SMALL_CNT);
+  quiet = true;
+  for (i = 0; i < SMALL_CNT; i++)
+    {
+      snprintf (name, sizeof name, "s%d", i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      CHECK (write (fd, small[i], SMALL_SIZE) == SMALL_SIZE,
+             "write \"%s\"", name);
+      close (fd);
+    }
+  quiet = false;
+
+  msg ("remove every other small file");
+  quiet = true;
+  for (i = 0; i < SMALL_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "s%d", i);
+      CHECK (remove (name), "remove \"%s\"", name);
+    }
+  quiet = false;
+
+  CHECK (create ("big", 0), "create \"big\"");
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  msg ("write \"big\"");
+  for (ofs = 0; ofs < BIG_SIZE; ofs += CHUNK_SIZE)
+    {
+      size_t size = BIG_SIZE - ofs < CHUNK_SIZE ? BIG_SIZE - ofs : CHUNK_SIZE;
+      if (write (fd, big + ofs, size) != (int) size)
+        fail ("write %zu bytes at offset %zu in \"big\" failed", size, ofs);
+    }
+  msg ("close \"big\"");
+  close (fd);
+
+  check_file ("big", big, BIG_SIZE);
+  msg ("check the remaining small files");
+  quiet = true;
+  for (i = 1; i < SMALL_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "s%d", i);
+      check_file (name, small[i], SMALL_SIZE);
+    }
+  quiet = false;
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-frag) begin
+(grow-frag) create 60 small files
+(grow-frag) remove every other small file
+(grow-frag) create "big"
+(grow-frag) open "big"
+(grow-frag) write "big"
+(grow-frag) close "big"
+(grow-frag) open "big" for verification
+(grow-frag) verified contents of "big"
+(grow-frag) close "big"
+(grow-frag) check the remaining small files
+(grow-frag) end
+EOF
+pass;
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($buf) = "\0" x 300000;
+substr ($buf, $_, 100) = random_bytes (100) foreach 0, 150000, 299900, 70000;
+check_archive ({"testfile" => [$buf]});
+pass;
@@ -0,0 +1,43 @@
+/* Writes a few small pieces far apart in a new file, leaving
+   large holes between them, then writes one more piece into the
+   middle of a hole, and checks that the holes read as zeros. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 300000
+#define PIECE_SIZE 100
+#define PIECE_CNT 4
+static char buf[FILE_SIZE];
+
+/* Where each piece goes, in the order written. */
+static const size_t piece_ofs[PIECE_CNT] =
+  {0, 150000, FILE_SIZE - PIECE_SIZE, 70000};
+
+void
+test_main (void) 
+{
+  const char *file_name = "testfile";
+  int fd;
+  int i;
+
+  random_init (0);
+  for (i = 0; i < PIECE_CNT; i++)
+    random_bytes (buf + piece_ofs[i], PIECE_SIZE);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (i = 0; i < PIECE_CNT; i++)
+    {
+      size_t ofs = piece_ofs[i];
+      msg ("seek \"%s\" to %zu", file_name, ofs);
+      seek (fd, ofs);
+      CHECK (write (fd, buf + ofs, PIECE_SIZE) == PIECE_SIZE,
+             "write \"%s\"", file_name);
+    }
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, FILE_SIZE);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-holes) begin
+(grow-holes) create "testfile"
+(grow-holes) open "testfile"
+(grow-holes) seek "testfile" to 0
+(grow-holes) write "testfile"
+(grow-holes) seek "testfile" to 150000
+(grow-holes) write "testfile"
+(grow-holes) seek "testfile" to 299900
+(grow-holes) write "testfile"
+(grow-holes) seek "testfile" to 70000
+(grow-holes) write "testfile"
+(grow-holes) close "testfile"
+(grow-holes) open "testfile" for verification
+(grow-holes) verified contents of "testfile"
+(grow-holes) close "testfile"
+(grow-holes) end
+EOF
+pass;
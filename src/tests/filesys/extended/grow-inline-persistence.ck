@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_archive ({"tiny" => ["\0" x 10], "small" => [random_bytes (3000)]});
+pass;
@@ -0,0 +1,46 @@
+/* Grows a small file a few bytes at a time past the size that
+   fits inside its inode, checking its contents at each step, and
+   checks a small file created with a nonzero initial size. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 3000
+static char buf[FILE_SIZE];
+static char zeros[10];
+
+/* File sizes to stop at, around where a file stops fitting in
+   its inode. */
+static const size_t sizes[] = {1, 100, 499, 500, 501, 512, 513, FILE_SIZE};
+
+void
+test_main (void)
+{
+  size_t ofs = 0;
+  size_t i;
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("tiny", sizeof zeros), "create \"tiny\"");
+  check_file ("tiny", zeros, sizeof zeros);
+
+  CHECK (create ("small", 0), "create \"small\"");
+  CHECK ((fd = open ("small")) > 1, "open \"small\"");
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t size = sizes[i] - ofs;
+
+      CHECK (write (fd, buf + ofs, size) == (int) size,
+             "write \"small\" up to %zu bytes", sizes[i]);
+      ofs = sizes[i];
+      seek (fd, 0);
+      check_file_handle (fd, "small", buf, ofs);
+    }
+  msg ("close \"small\"");
+  close (fd);
+  check_file ("small", buf, FILE_SIZE);
+}
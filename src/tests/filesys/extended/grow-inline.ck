@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-inline) begin
+(grow-inline) create "tiny"
+(grow-inline) open "tiny" for verification
+(grow-inline) verified contents of "tiny"
+(grow-inline) close "tiny"
+(grow-inline) create "small"
+(grow-inline) open "small"
+(grow-inline) write "small" up to 1 bytes
+(grow-inline) verified contents of "small"
+(grow-inline) write "small" up to 100 bytes
+(grow-inline) verified contents of "small"
+(grow-inline) write "small" up to 499 bytes
+(grow-inline) verified contents of "small"
+(grow-inline) write "small" up to 500 bytes
+(grow-inline) verified contents of "small"
+(grow-inline) write "small" up to 501 bytes
+(grow-inline) verified contents of "small"
+(grow-inline) write "small" up to 512 bytes
+(grow-inline) verified contents of "small"
+(grow-inline) write "small" up to 513 bytes
+(grow-inline) verified contents of "small"
+(grow-inline) write "small" up to 3000 bytes
+(grow-inline) verified contents of "small"
+(grow-inline) close "small"
+(grow-inline) open "small" for verification
+(grow-inline) verified contents of "small"
+(grow-inline) close "small"
+(grow-inline) end
+EOF
+pass;
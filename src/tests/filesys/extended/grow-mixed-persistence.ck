@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my (%fs);
+$fs{"f$_"} = [random_bytes (20000)] foreach 0...3;
+$fs{'d'}{"e$_"} = [""] foreach 0...66;
+check_archive (\%fs);
+pass;
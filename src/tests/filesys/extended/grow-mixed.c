@@ -0,0 +1,68 @@
+/* Grows four files and a directory together, a little at a time,
+   so that their allocations keep landing next to each other, and
+   checks that every file and directory entry comes out intact. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 4
+#define FILE_SIZE 20000
+#define CHUNK_SIZE 300
+static char buf[FILE_CNT][FILE_SIZE];
+
+void
+test_main (void)
+{
+  int fd[FILE_CNT];
+  char name[16];
+  size_t ofs;
+  int entries = 0;
+  int i;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "f%d", i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+      CHECK ((fd[i] = open (name)) > 1, "open \"%s\"", name);
+    }
+
+  msg ("write the files and fill \"d\" in turn");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      size_t size = (FILE_SIZE - ofs < CHUNK_SIZE
+                     ? FILE_SIZE - ofs : CHUNK_SIZE);
+      for (i = 0; i < FILE_CNT; i++)
+        if (write (fd[i], buf[i] + ofs, size) != (int) size)
+          fail ("write %zu bytes at offset %zu in \"f%d\" failed",
+                size, ofs, i);
+      snprintf (name, sizeof name, "d/e%d", entries++);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+
+  msg ("close the files");
+  for (i = 0; i < FILE_CNT; i++)
+    close (fd[i]);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "f%d", i);
+      check_file (name, buf[i], FILE_SIZE);
+    }
+  msg ("open every entry of \"d\"");
+  for (i = 0; i < entries; i++)
+    {
+      int entry_fd;
+      snprintf (name, sizeof name, "d/e%d", i);
+      if ((entry_fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (entry_fd);
+    }
+}
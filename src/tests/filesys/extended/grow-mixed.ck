@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-mixed) begin
+(grow-mixed) mkdir "d"
+(grow-mixed) create "f0"
+(grow-mixed) open "f0"
+(grow-mixed) create "f1"
+(grow-mixed) open "f1"
+(grow-mixed) create "f2"
+(grow-mixed) open "f2"
+(grow-mixed) create "f3"
+(grow-mixed) open "f3"
+(grow-mixed) write the files and fill "d" in turn
+(grow-mixed) close the files
+(grow-mixed) open "f0" for verification
+(grow-mixed) verified contents of "f0"
+(grow-mixed) close "f0"
+(grow-mixed) open "f1" for verification
+(grow-mixed) verified contents of "f1"
+(grow-mixed) close "f1"
+(grow-mixed) open "f2" for verification
+(grow-mixed) verified contents of "f2"
+(grow-mixed) close "f2"
+(grow-mixed) open "f3" for verification
+(grow-mixed) verified contents of "f3"
+(grow-mixed) close "f3"
+(grow-mixed) open every entry of "d"
+(grow-mixed) end
+EOF
+pass;
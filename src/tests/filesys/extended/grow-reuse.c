@@ -0,0 +1,54 @@
+/* Writes a large file and removes it again, over and over, so
+   that the space written in all rounds adds up to more than the
+   whole disk.  Each round must get back the space the previous
+   one released, whether or not its sectors had been placed on
+   disk yet. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 200000
+#define CHUNK_SIZE 4096
+#define ROUND_CNT 12
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  size_t ofs;
+  int round;
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  msg ("write and remove \"testfile\" %d times", ROUND_CNT);
+  quiet = true;
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      CHECK (create ("testfile", 0), "create \"testfile\"");
+      CHECK ((fd = open ("testfile")) > 1, "open \"testfile\"");
+      for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+        {
+          size_t size = (FILE_SIZE - ofs < CHUNK_SIZE
+                         ? FILE_SIZE - ofs : CHUNK_SIZE);
+          if (write (fd, buf + ofs, size) != (int) size)
+            fail ("write %zu bytes at offset %zu in round %d failed",
+                  size, ofs, round);
+        }
+      seek (fd, 0);
+      check_file_handle (fd, "testfile", buf, FILE_SIZE);
+      close (fd);
+      CHECK (remove ("testfile"), "remove \"testfile\"");
+    }
+  quiet = false;
+
+  CHECK (create ("testfile", 0), "create \"testfile\"");
+  CHECK ((fd = open ("testfile")) > 1, "open \"testfile\"");
+  CHECK (write (fd, buf, FILE_SIZE) == FILE_SIZE, "write \"testfile\"");
+  msg ("close \"testfile\"");
+  close (fd);
+  check_file ("testfile", buf, FILE_SIZE);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-reuse) begin
+(grow-reuse) write and remove "testfile" 12 times
+(grow-reuse) create "testfile"
+(grow-reuse) open "testfile"
+(grow-reuse) write "testfile"
+(grow-reuse) close "testfile"
+(grow-reuse) open "testfile" for verification
+(grow-reuse) verified contents of "testfile"
+(grow-reuse) close "testfile"
+(grow-reuse) end
+EOF
+pass;
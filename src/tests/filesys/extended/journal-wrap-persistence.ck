@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($buf) = random_bytes (512);
+check_archive ({"keep" => {"file" => [$buf]}});
+pass;
@@ -0,0 +1,50 @@
+/* Makes and removes a directory and a file in it many times,
+   committing each time with sync(), so that the metadata journal
+   wraps around several times, then makes a directory and file to
+   keep.  The persistence check, after a reboot that replays the
+   journal, finds only what was kept. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUND_CNT 100
+static char buf[512];
+
+void
+test_main (void) 
+{
+  char dir_name[16], file_name[32];
+  int fd;
+  int i;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  msg ("make and remove a directory %d times", ROUND_CNT);
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      snprintf (dir_name, sizeof dir_name, "d%d", i);
+      snprintf (file_name, sizeof file_name, "%s/f", dir_name);
+      if (!mkdir (dir_name))
+        fail ("mkdir \"%s\"", dir_name);
+      if (!create (file_name, sizeof buf))
+        fail ("create \"%s\"", file_name);
+      sync ();
+      if (!remove (file_name))
+        fail ("remove \"%s\"", file_name);
+      if (!remove (dir_name))
+        fail ("remove \"%s\"", dir_name);
+      sync ();
+    }
+
+  CHECK (mkdir ("keep"), "mkdir \"keep\"");
+  CHECK (create ("keep/file", 0), "create \"keep/file\"");
+  CHECK ((fd = open ("keep/file")) > 1, "open \"keep/file\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"keep/file\"");
+  msg ("close \"keep/file\"");
+  close (fd);
+  check_file ("keep/file", buf, sizeof buf);
+}
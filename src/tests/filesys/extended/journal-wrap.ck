@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(journal-wrap) begin
+(journal-wrap) make and remove a directory 100 times
+(journal-wrap) mkdir "keep"
+(journal-wrap) create "keep/file"
+(journal-wrap) open "keep/file"
+(journal-wrap) write "keep/file"
+(journal-wrap) close "keep/file"
+(journal-wrap) open "keep/file" for verification
+(journal-wrap) verified contents of "keep/file"
+(journal-wrap) close "keep/file"
+(journal-wrap) end
+EOF
+pass;
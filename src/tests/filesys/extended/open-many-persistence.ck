@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (%fs) = ("shared" => [""]);
+$fs{"f$_"} = ["f$_"] foreach 0...39;
+check_archive (\%fs);
+pass;
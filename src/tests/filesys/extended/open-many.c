@@ -0,0 +1,81 @@
+/* Opens one file many times and many files once each, checks
+   that writes through one handle of a file are seen through the
+   others and that the other files keep their own contents, then
+   removes the shared file while it is still open. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OPEN_CNT 20
+#define FILE_CNT 40
+#define BUF_SIZE 1000
+static char buf[BUF_SIZE];
+
+void
+test_main (void)
+{
+  int same[OPEN_CNT];
+  int other[FILE_CNT];
+  char name[16];
+  char block[BUF_SIZE];
+  int i;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("shared", 0), "create \"shared\"");
+  msg ("open \"shared\" %d times", OPEN_CNT);
+  for (i = 0; i < OPEN_CNT; i++)
+    if ((same[i] = open ("shared")) < 2)
+      fail ("open \"shared\" failed");
+
+  msg ("create and open %d other files", FILE_CNT);
+  quiet = true;
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "f%d", i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+      CHECK ((other[i] = open (name)) > 1, "open \"%s\"", name);
+      CHECK (write (other[i], name, strlen (name)) == (int) strlen (name),
+             "write \"%s\"", name);
+    }
+  quiet = false;
+
+  CHECK (write (same[0], buf, BUF_SIZE) == BUF_SIZE, "write \"shared\"");
+  msg ("read \"shared\" through every handle");
+  for (i = 1; i < OPEN_CNT; i++)
+    {
+      if (read (same[i], block, BUF_SIZE) != BUF_SIZE)
+        fail ("read \"shared\" through handle %d failed", i);
+      compare_bytes (block, buf, BUF_SIZE, 0, "shared");
+    }
+  msg ("read the other files");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "f%d", i);
+      seek (other[i], 0);
+      if (read (other[i], block, BUF_SIZE) != (int) strlen (name))
+        fail ("read \"%s\" failed", name);
+      compare_bytes (block, name, strlen (name), 0, name);
+    }
+
+  CHECK (remove ("shared"), "remove \"shared\"");
+  CHECK (open ("shared") == -1, "open \"shared\" (must fail)");
+  CHECK (create ("shared", 0), "create \"shared\" again");
+  msg ("read removed \"shared\" through an open handle");
+  seek (same[OPEN_CNT - 1], 0);
+  if (read (same[OPEN_CNT - 1], block, BUF_SIZE) != BUF_SIZE)
+    fail ("read removed \"shared\" failed");
+  compare_bytes (block, buf, BUF_SIZE, 0, "shared");
+
+  msg ("close all files");
+  for (i = 0; i < OPEN_CNT; i++)
+    close (same[i]);
+  for (i = 0; i < FILE_CNT; i++)
+    close (other[i]);
+  check_file ("shared", NULL, 0);
+}
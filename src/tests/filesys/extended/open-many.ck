@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(open-many) begin
+(open-many) create "shared"
+(open-many) open "shared" 20 times
+(open-many) create and open 40 other files
+(open-many) write "shared"
+(open-many) read "shared" through every handle
+(open-many) read the other files
+(open-many) remove "shared"
+(open-many) open "shared" (must fail)
+(open-many) create "shared" again
+(open-many) read removed "shared" through an open handle
+(open-many) close all files
+(open-many) open "shared" for verification
+(open-many) verified contents of "shared"
+(open-many) close "shared"
+(open-many) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Writes a file with pwrite(), a block at a time from back to
+   front, reads it back with pread(), and checks that neither
+   moves the file position. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 5678
+#define BLOCK_SIZE 1000
+static char buf[FILE_SIZE];
+static char read_buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "testfile";
+  size_t ofs;
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  msg ("pwrite \"%s\" from back to front", file_name);
+  ofs = (FILE_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+  for (;;)
+    {
+      size_t block_size = FILE_SIZE - ofs;
+      size_t ret_val;
+      if (block_size > BLOCK_SIZE)
+        block_size = BLOCK_SIZE;
+
+      ret_val = pwrite (fd, buf + ofs, block_size, ofs);
+      if (ret_val != block_size)
+        fail ("pwrite %zu bytes at offset %zu in \"%s\" returned %zu",
+              block_size, ofs, file_name, ret_val);
+      if (ofs == 0)
+        break;
+      ofs -= BLOCK_SIZE;
+    }
+  CHECK (tell (fd) == 0, "tell \"%s\" after pwrite", file_name);
+
+  CHECK (pread (fd, read_buf, FILE_SIZE, 0) == FILE_SIZE,
+         "pread \"%s\"", file_name);
+  compare_bytes (read_buf, buf, FILE_SIZE, 0, file_name);
+  CHECK (pread (fd, read_buf, 100, FILE_SIZE - 10) == 10,
+         "pread across end of \"%s\"", file_name);
+  CHECK (pread (fd, read_buf, 100, FILE_SIZE) == 0,
+         "pread at end of \"%s\"", file_name);
+  CHECK (tell (fd) == 0, "tell \"%s\" after pread", file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, FILE_SIZE);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "testfile"
+(pread-pwrite) open "testfile"
+(pread-pwrite) pwrite "testfile" from back to front
+(pread-pwrite) tell "testfile" after pwrite
+(pread-pwrite) pread "testfile"
+(pread-pwrite) pread across end of "testfile"
+(pread-pwrite) pread at end of "testfile"
+(pread-pwrite) tell "testfile" after pread
+(pread-pwrite) close "testfile"
+(pread-pwrite) open "testfile" for verification
+(pread-pwrite) verified contents of "testfile"
+(pread-pwrite) close "testfile"
+(pread-pwrite) end
+EOF
+pass;
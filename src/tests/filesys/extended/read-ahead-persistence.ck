@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($buf) = random_bytes (20480);
+substr ($buf, 5120, 5120) = random_bytes (5120);
+check_archive ({"testfile" => [$buf]});
+pass;
@@ -0,0 +1,66 @@
+/* Reads a file one sector at a time, so that the sectors ahead
+   of the reader are fetched in the background, then overwrites
+   the next sectors through a second handle before the reader
+   gets to them.  The reader must see the new data, not a stale
+   copy fetched ahead of it. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define FILE_SIZE (40 * SECTOR_SIZE)
+#define PATCH_OFS (10 * SECTOR_SIZE)
+#define PATCH_SIZE (10 * SECTOR_SIZE)
+static char buf[FILE_SIZE];
+static char patch[PATCH_SIZE];
+
+static void
+read_sectors (int fd, size_t ofs, size_t end)
+{
+  char block[SECTOR_SIZE];
+
+  for (; ofs < end; ofs += SECTOR_SIZE)
+    {
+      if (read (fd, block, SECTOR_SIZE) != SECTOR_SIZE)
+        fail ("read %d bytes at offset %zu in \"testfile\" failed",
+              SECTOR_SIZE, ofs);
+      compare_bytes (block, buf + ofs, SECTOR_SIZE, ofs, "testfile");
+    }
+}
+
+void
+test_main (void)
+{
+  int fd_r, fd_w;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+  random_bytes (patch, sizeof patch);
+
+  CHECK (create ("testfile", 0), "create \"testfile\"");
+  CHECK ((fd_w = open ("testfile")) > 1, "open \"testfile\" for writing");
+  CHECK (write (fd_w, buf, FILE_SIZE) == FILE_SIZE,
+         "write \"testfile\"");
+  CHECK ((fd_r = open ("testfile")) > 1, "open \"testfile\" for reading");
+
+  msg ("read the first %d sectors", PATCH_OFS / SECTOR_SIZE);
+  read_sectors (fd_r, 0, PATCH_OFS);
+
+  msg ("overwrite the next %d sectors", PATCH_SIZE / SECTOR_SIZE);
+  seek (fd_w, PATCH_OFS);
+  CHECK (write (fd_w, patch, PATCH_SIZE) == PATCH_SIZE,
+         "write \"testfile\"");
+  memcpy (buf + PATCH_OFS, patch, PATCH_SIZE);
+
+  msg ("read the rest");
+  read_sectors (fd_r, PATCH_OFS, FILE_SIZE);
+
+  msg ("close \"testfile\"");
+  close (fd_r);
+  close (fd_w);
+
+  check_file ("testfile", buf, FILE_SIZE);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(read-ahead) begin
+(read-ahead) create "testfile"
+(read-ahead) open "testfile" for writing
+(read-ahead) write "testfile"
+(read-ahead) open "testfile" for reading
+(read-ahead) read the first 10 sectors
+(read-ahead) overwrite the next 10 sectors
+(read-ahead) write "testfile"
+(read-ahead) read the rest
+(read-ahead) close "testfile"
+(read-ahead) open "testfile" for verification
+(read-ahead) verified contents of "testfile"
+(read-ahead) close "testfile"
+(read-ahead) end
+EOF
+pass;
@@ -0,0 +1,54 @@
+/* Writes a file with writev() from buffers of uneven sizes, one
+   of them empty, then reads it back with readv() into buffers
+   split at other places. */
+
+#include <iovec.h>
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 3001
+static char buf[FILE_SIZE];
+static char read_buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "testfile";
+  struct iovec iov[4];
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = buf + 1;
+  iov[1].iov_len = 1500;
+  iov[2].iov_base = buf + 1501;
+  iov[2].iov_len = 0;
+  iov[3].iov_base = buf + 1501;
+  iov[3].iov_len = 1500;
+  CHECK (writev (fd, iov, 4) == FILE_SIZE, "writev \"%s\"", file_name);
+  CHECK (tell (fd) == FILE_SIZE, "tell \"%s\"", file_name);
+
+  msg ("seek \"%s\" to 0", file_name);
+  seek (fd, 0);
+  iov[0].iov_base = read_buf;
+  iov[0].iov_len = 512;
+  iov[1].iov_base = read_buf + 512;
+  iov[1].iov_len = 1000;
+  iov[2].iov_base = read_buf + 1512;
+  iov[2].iov_len = FILE_SIZE - 1512;
+  CHECK (readv (fd, iov, 3) == FILE_SIZE, "readv \"%s\"", file_name);
+  compare_bytes (read_buf, buf, FILE_SIZE, 0, file_name);
+  CHECK (readv (fd, iov, 3) == 0, "readv at end of \"%s\"", file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, FILE_SIZE);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "testfile"
+(readv-writev) open "testfile"
+(readv-writev) writev "testfile"
+(readv-writev) tell "testfile"
+(readv-writev) seek "testfile" to 0
+(readv-writev) readv "testfile"
+(readv-writev) readv at end of "testfile"
+(readv-writev) close "testfile"
+(readv-writev) open "testfile" for verification
+(readv-writev) verified contents of "testfile"
+(readv-writev) close "testfile"
+(readv-writev) end
+EOF
+pass;
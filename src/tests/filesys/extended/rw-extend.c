@@ -0,0 +1,53 @@
+/* Extends a file through one handle while reading it through
+   another, checking that the reader sees every byte written so
+   far, that it finds end of file right after them, and that both
+   handles agree on the file's size. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 30000
+#define CHUNK_SIZE 700
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  char block[CHUNK_SIZE];
+  int fd_r, fd_w;
+  size_t ofs;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("testfile", 0), "create \"testfile\"");
+  CHECK ((fd_w = open ("testfile")) > 1, "open \"testfile\" for writing");
+  CHECK ((fd_r = open ("testfile")) > 1, "open \"testfile\" for reading");
+
+  msg ("append to \"testfile\" and read each piece back");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      size_t size = (FILE_SIZE - ofs < CHUNK_SIZE
+                     ? FILE_SIZE - ofs : CHUNK_SIZE);
+
+      if (read (fd_r, block, sizeof block) != 0)
+        fail ("read at end of \"testfile\" returned data at offset %zu", ofs);
+      if (write (fd_w, buf + ofs, size) != (int) size)
+        fail ("write %zu bytes at offset %zu in \"testfile\" failed",
+              size, ofs);
+      if (filesize (fd_r) != (int) (ofs + size))
+        fail ("size of \"testfile\" is %d, not %zu",
+              filesize (fd_r), ofs + size);
+      if (read (fd_r, block, sizeof block) != (int) size)
+        fail ("read %zu bytes at offset %zu in \"testfile\" failed",
+              size, ofs);
+      compare_bytes (block, buf + ofs, size, ofs, "testfile");
+    }
+
+  msg ("close \"testfile\"");
+  close (fd_r);
+  close (fd_w);
+  check_file ("testfile", buf, FILE_SIZE);
+}
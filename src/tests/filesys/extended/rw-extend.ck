@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rw-extend) begin
+(rw-extend) create "testfile"
+(rw-extend) open "testfile" for writing
+(rw-extend) open "testfile" for reading
+(rw-extend) append to "testfile" and read each piece back
+(rw-extend) close "testfile"
+(rw-extend) open "testfile" for verification
+(rw-extend) verified contents of "testfile"
+(rw-extend) close "testfile"
+(rw-extend) end
+EOF
+pass;
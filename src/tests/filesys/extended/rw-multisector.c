@@ -0,0 +1,44 @@
+/* Writes a file in one call that spans many sectors, reads it
+   back in one call, and reads a long stretch that starts and
+   ends in the middle of sectors. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 65536
+#define PART_OFS 1000
+#define PART_SIZE 40000
+static char buf[FILE_SIZE];
+static char copy[FILE_SIZE];
+
+void
+test_main (void)
+{
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("testfile", 0), "create \"testfile\"");
+  CHECK ((fd = open ("testfile")) > 1, "open \"testfile\"");
+  CHECK (write (fd, buf, FILE_SIZE) == FILE_SIZE,
+         "write %d bytes to \"testfile\"", FILE_SIZE);
+  msg ("close \"testfile\"");
+  close (fd);
+
+  CHECK ((fd = open ("testfile")) > 1, "open \"testfile\"");
+  CHECK (read (fd, copy, FILE_SIZE) == FILE_SIZE,
+         "read %d bytes from \"testfile\"", FILE_SIZE);
+  compare_bytes (copy, buf, FILE_SIZE, 0, "testfile");
+
+  memset (copy, 0, sizeof copy);
+  seek (fd, PART_OFS);
+  CHECK (read (fd, copy, PART_SIZE) == PART_SIZE,
+         "read %d bytes at offset %d in \"testfile\"", PART_SIZE, PART_OFS);
+  compare_bytes (copy, buf + PART_OFS, PART_SIZE, PART_OFS, "testfile");
+  msg ("close \"testfile\"");
+  close (fd);
+}
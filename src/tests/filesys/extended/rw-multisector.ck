@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rw-multisector) begin
+(rw-multisector) create "testfile"
+(rw-multisector) open "testfile"
+(rw-multisector) write 65536 bytes to "testfile"
+(rw-multisector) close "testfile"
+(rw-multisector) open "testfile"
+(rw-multisector) read 65536 bytes from "testfile"
+(rw-multisector) read 40000 bytes at offset 1000 in "testfile"
+(rw-multisector) close "testfile"
+(rw-multisector) end
+EOF
+pass;
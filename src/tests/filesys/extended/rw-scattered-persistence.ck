@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($buf) = random_bytes (51200);
+substr ($buf, $_ * 5120, 512) = random_bytes (512) foreach 0...9;
+check_archive ({"testfile" => [$buf]});
+pass;
@@ -0,0 +1,58 @@
+/* Writes the sectors of a file in shuffled order, then writes
+   some of them a second time in the opposite order, so that
+   several writes to far-apart and to identical sectors are in
+   flight together.  The last write to each sector must win. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 100
+#define REWRITE_CNT 10
+#define FILE_SIZE (SECTOR_CNT * SECTOR_SIZE)
+static char buf[FILE_SIZE];
+static char rewrite[REWRITE_CNT][SECTOR_SIZE];
+static size_t order[SECTOR_CNT];
+
+static void
+write_sector (int fd, size_t sector, const char *data)
+{
+  seek (fd, sector * SECTOR_SIZE);
+  if (write (fd, data, SECTOR_SIZE) != SECTOR_SIZE)
+    fail ("write sector %zu of \"testfile\" failed", sector);
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+  random_bytes (rewrite, sizeof rewrite);
+  for (i = 0; i < SECTOR_CNT; i++)
+    order[i] = i;
+  shuffle (order, SECTOR_CNT, sizeof *order);
+
+  CHECK (create ("testfile", 0), "create \"testfile\"");
+  CHECK ((fd = open ("testfile")) > 1, "open \"testfile\"");
+
+  msg ("write the sectors of \"testfile\" in shuffled order");
+  for (i = 0; i < SECTOR_CNT; i++)
+    write_sector (fd, order[i], buf + order[i] * SECTOR_SIZE);
+
+  msg ("write %d of them again in reverse order", REWRITE_CNT);
+  for (i = REWRITE_CNT; i-- > 0; )
+    {
+      write_sector (fd, i * 10, rewrite[i]);
+      memcpy (buf + i * 10 * SECTOR_SIZE, rewrite[i], SECTOR_SIZE);
+    }
+
+  msg ("close \"testfile\"");
+  close (fd);
+  check_file ("testfile", buf, FILE_SIZE);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rw-scattered) begin
+(rw-scattered) create "testfile"
+(rw-scattered) open "testfile"
+(rw-scattered) write the sectors of "testfile" in shuffled order
+(rw-scattered) write 10 of them again in reverse order
+(rw-scattered) close "testfile"
+(rw-scattered) open "testfile" for verification
+(rw-scattered) verified contents of "testfile"
+(rw-scattered) close "testfile"
+(rw-scattered) end
+EOF
+pass;
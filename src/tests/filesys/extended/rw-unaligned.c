@@ -0,0 +1,55 @@
+/* Writes a file in pieces whose sizes and offsets do not line up
+   with sector boundaries, from buffers that do not start on a
+   word boundary, then reads it back in pieces of other odd sizes
+   into similarly misaligned buffers. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 30000
+static char buf[FILE_SIZE];
+static char copy[FILE_SIZE + 1];
+
+static const size_t write_sizes[] = {1, 511, 513, 1023, 4097, 3, 2000};
+static const size_t read_sizes[] = {7, 1025, 509, 2, 8191, 517};
+
+void
+test_main (void)
+{
+  size_t ofs, size;
+  size_t i;
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("testfile", 0), "create \"testfile\"");
+  CHECK ((fd = open ("testfile")) > 1, "open \"testfile\"");
+  msg ("write \"testfile\" in odd pieces");
+  for (ofs = 0, i = 0; ofs < FILE_SIZE; ofs += size, i++)
+    {
+      size = write_sizes[i % (sizeof write_sizes / sizeof *write_sizes)];
+      if (size > FILE_SIZE - ofs)
+        size = FILE_SIZE - ofs;
+      if (write (fd, buf + ofs, size) != (int) size)
+        fail ("write %zu bytes at offset %zu in \"testfile\" failed",
+              size, ofs);
+    }
+
+  msg ("read \"testfile\" in other odd pieces");
+  seek (fd, 0);
+  for (ofs = 0, i = 0; ofs < FILE_SIZE; ofs += size, i++)
+    {
+      size = read_sizes[i % (sizeof read_sizes / sizeof *read_sizes)];
+      if (size > FILE_SIZE - ofs)
+        size = FILE_SIZE - ofs;
+      if (read (fd, copy + 1 + ofs, size) != (int) size)
+        fail ("read %zu bytes at offset %zu in \"testfile\" failed",
+              size, ofs);
+    }
+  compare_bytes (copy + 1, buf, FILE_SIZE, 0, "testfile");
+  msg ("close \"testfile\"");
+  close (fd);
+}
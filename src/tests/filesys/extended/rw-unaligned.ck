@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rw-unaligned) begin
+(rw-unaligned) create "testfile"
+(rw-unaligned) open "testfile"
+(rw-unaligned) write "testfile" in odd pieces
+(rw-unaligned) read "testfile" in other odd pieces
+(rw-unaligned) close "testfile"
+(rw-unaligned) end
+EOF
+pass;
@@ -0,0 +1,35 @@
+/* Writes a file, calls fsync() on it, writes more, and calls
+   sync().  The persistence check then finds all of it on disk. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 4321
+#define FIRST_SIZE 3000
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "testfile";
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, FIRST_SIZE) == FIRST_SIZE,
+         "write %d bytes to \"%s\"", FIRST_SIZE, file_name);
+  CHECK (fsync (fd), "fsync \"%s\"", file_name);
+  CHECK (write (fd, buf + FIRST_SIZE, FILE_SIZE - FIRST_SIZE)
+         == FILE_SIZE - FIRST_SIZE,
+         "write %d more bytes to \"%s\"", FILE_SIZE - FIRST_SIZE, file_name);
+  msg ("sync");
+  sync ();
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, FILE_SIZE);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sync-fsync) begin
+(sync-fsync) create "testfile"
+(sync-fsync) open "testfile"
+(sync-fsync) write 3000 bytes to "testfile"
+(sync-fsync) fsync "testfile"
+(sync-fsync) write 1321 more bytes to "testfile"
+(sync-fsync) sync
+(sync-fsync) close "testfile"
+(sync-fsync) open "testfile" for verification
+(sync-fsync) verified contents of "testfile"
+(sync-fsync) close "testfile"
+(sync-fsync) end
+EOF
+pass;
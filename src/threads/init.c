@@ -31,8 +31,10 @@
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/inode.h"
 #endif
 
 /* Amount of physical memory, in 4 kB pages. */
@@ -239,6 +241,16 @@ parse_options (char **argv)
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
+      else if (!strcmp (name, "-flush-age"))
+        {
+          cache_flush_age = value != NULL ? atoi (value) : 0;
+          if (cache_flush_age <= 0)
+            PANIC ("-flush-age needs a positive number of milliseconds");
+        }
+      else if (!strcmp (name, "-extents"))
+        inode_use_extents = true;
+      else if (!strcmp (name, "-pio"))
+        disk_use_dma = false;
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
@@ -347,6 +359,11 @@ usage (void)
           "  -h                 Print this help message and power off.\n"
           "  -q                 Power off VM after actions or on panic.\n"
           "  -f                 Format file system disk during startup.\n"
+#ifdef FILESYS
+          "  -flush-age=MS      Write back cached data after MS milliseconds.\n"
+          "  -extents           Create files with extent-based inodes.\n"
+          "  -pio               Transfer disk data by PIO, never by DMA.\n"
+#endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
@@ -338,3 +338,109 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RW.  Any number of threads may hold a
+   readers-writer lock for reading at once, but a thread that
+   holds it for writing excludes all others.
+
+   A thread that wants to write waits only for the readers that
+   are already inside: new readers queue up behind it, so a
+   steady stream of readers cannot starve writers.  When a writer
+   leaves, the readers that queued up meanwhile all go in before
+   the next writer, so a stream of writers cannot starve readers
+   either. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->readers_ok);
+  cond_init (&rw->writer_ok);
+  rw->readers = 0;
+  rw->readers_waiting = 0;
+  rw->writers_waiting = 0;
+  rw->read_passes = 0;
+  rw->writer = NULL;
+}
+
+/* Acquires RW for reading, sleeping until no thread is writing
+   and, unless the last writer let us in, none is waiting to. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  rw->readers_waiting++;
+  while (rw->writer != NULL
+         || (rw->writers_waiting > 0 && rw->read_passes == 0))
+    cond_wait (&rw->readers_ok, &rw->lock);
+  rw->readers_waiting--;
+  if (rw->read_passes > 0)
+    rw->read_passes--;
+  rw->readers++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0)
+    cond_signal (&rw->writer_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  RW must not already be held by the current thread. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer != thread_current ());
+  rw->writers_waiting++;
+  while (rw->writer != NULL || rw->readers > 0 || rw->read_passes > 0)
+    cond_wait (&rw->writer_ok, &rw->lock);
+  rw->writers_waiting--;
+  rw->writer = thread_current ();
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing.
+   Readers that are waiting go first, then the next writer. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer == thread_current ());
+  rw->writer = NULL;
+  if (rw->readers_waiting > 0)
+    {
+      rw->read_passes = rw->readers_waiting;
+      cond_broadcast (&rw->readers_ok, &rw->lock);
+    }
+  else
+    cond_signal (&rw->writer_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
@@ -41,6 +41,26 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /* Guards the members below. */
+    struct condition readers_ok; /* Signaled when readers may enter. */
+    struct condition writer_ok; /* Signaled when a writer may enter. */
+    unsigned readers;           /* Number of threads reading. */
+    unsigned readers_waiting;   /* Number of readers waiting. */
+    unsigned writers_waiting;   /* Number of writers waiting. */
+    unsigned read_passes;       /* Readers let in ahead of writers. */
+    struct thread *writer;      /* Thread writing, or null. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
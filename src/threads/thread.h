@@ -120,6 +120,20 @@ struct thread
     /* Added for lab 1. */
     struct file *fd_list[130];          /* Struct file pointers to all opened files. */
 #endif
+#ifdef FILESYS
+    /* Owned by filesys/filesys.c. */
+    struct dir *cwd;                    /* Working directory, or null
+                                           for the root directory. */
+
+    /* Owned by filesys/journal.c. */
+    int journal_depth;                  /* Nesting depth of handles. */
+    size_t journal_logged;              /* Sectors first logged by the
+                                           outermost handle. */
+
+    /* Owned by filesys/free-map.c. */
+    size_t free_map_reserved;           /* Reserved sectors that this
+                                           thread may allocate. */
+#endif
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -30,6 +30,7 @@ process_execute (const char *cmd_line)
     status->exit_status = -1; // So we know that it failed
     status->alive_count = 1;  // Parent is still alive
     return TID_ERROR;
+  }
 
   /* Make a copy of cmd_line.
      Otherwise there's a race between the caller and load(). */
@@ -205,6 +206,9 @@ process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  dir_close (cur->cwd);
+  cur->cwd = NULL;
 }
 
 /* Sets up the CPU for running user code in the current
@@ -173,6 +173,169 @@ syscall_handler (struct intr_frame *f)
     f->eax = wait (wait_arg);
   }
 
+  else if (syscall_nr == SYS_SYNC)
+  {
+    sync ();
+  }
+
+  else if (syscall_nr == SYS_FSYNC)
+  {
+    if (!(is_ptr_valid(ARG_1))) exit(-1);
+
+    int _arg_1 = *((int*)ARG_1);
+    if (!(is_fd_valid(_arg_1))) exit(-1);
+
+    f->eax = fsync (_arg_1);
+  }
+
+  else if (syscall_nr == SYS_CHDIR)
+  {
+    if (!(is_ptr_valid(ARG_1))) exit(-1);
+
+    char *_arg_1 = *((char**)ARG_1);
+    if (!(is_str_valid(_arg_1))) exit(-1);
+
+    f->eax = chdir (_arg_1);
+  }
+
+  else if (syscall_nr == SYS_MKDIR)
+  {
+    if (!(is_ptr_valid(ARG_1))) exit(-1);
+
+    char *_arg_1 = *((char**)ARG_1);
+    if (!(is_str_valid(_arg_1))) exit(-1);
+
+    f->eax = mkdir (_arg_1);
+  }
+
+  else if (syscall_nr == SYS_READDIR)
+  {
+    if (!(is_ptr_valid(ARG_1)) || !(is_ptr_valid(ARG_2))) exit(-1);
+
+    int _arg_1 = *((int*)ARG_1);
+    if (!(is_fd_valid(_arg_1))) exit(-1);
+
+    char *_arg_2 = *((char**)ARG_2);
+    if (!(is_bufr_valid(_arg_2, READDIR_MAX_LEN + 1))) exit(-1);
+
+    f->eax = readdir (_arg_1, _arg_2);
+  }
+
+  else if (syscall_nr == SYS_ISDIR)
+  {
+    if (!(is_ptr_valid(ARG_1))) exit(-1);
+
+    int _arg_1 = *((int*)ARG_1);
+    if (!(is_fd_valid(_arg_1))) exit(-1);
+
+    f->eax = isdir (_arg_1);
+  }
+
+  else if (syscall_nr == SYS_INUMBER)
+  {
+    if (!(is_ptr_valid(ARG_1))) exit(-1);
+
+    int _arg_1 = *((int*)ARG_1);
+    if (!(is_fd_valid(_arg_1))) exit(-1);
+
+    f->eax = inumber (_arg_1);
+  }
+
+  else if (syscall_nr == SYS_GETDENTS)
+  {
+    if (!(is_ptr_valid(ARG_1)) || !(is_ptr_valid(ARG_2))
+    || !(is_ptr_valid(ARG_3))) exit(-1);
+
+    int _arg_1 = *((int*)ARG_1);
+    if (!(is_fd_valid(_arg_1))) exit(-1);
+
+    struct dirent *_arg_2 = *((struct dirent**)ARG_2);
+    unsigned _arg_3 = *((unsigned*)ARG_3);
+    if (_arg_3 > INT_MAX / sizeof *_arg_2) _arg_3 = INT_MAX / sizeof *_arg_2;
+    if (!(is_bufr_valid(_arg_2, _arg_3 * sizeof *_arg_2))) exit(-1);
+
+    f->eax = getdents (_arg_1, _arg_2, _arg_3);
+  }
+
+  else if (syscall_nr == SYS_PREAD || syscall_nr == SYS_PWRITE)
+  {
+    if (!(is_ptr_valid(ARG_1)) || !(is_ptr_valid(ARG_2))
+    || !(is_ptr_valid(ARG_3)) || !(is_ptr_valid(ARG_4))) exit(-1);
+
+    int _arg_1 = *((int*)ARG_1);
+    if (!(is_fd_valid(_arg_1))) exit(-1);
+
+    void *_arg_2 = *((void**)ARG_2);
+    unsigned _arg_3 = *((unsigned*)ARG_3);
+    if (!(is_bufr_valid(_arg_2, _arg_3))) exit(-1);
+
+    unsigned _arg_4 = *((unsigned*)ARG_4);
+
+    if (syscall_nr == SYS_PREAD)
+      f->eax = pread (_arg_1, _arg_2, _arg_3, _arg_4);
+    else
+      f->eax = pwrite (_arg_1, _arg_2, _arg_3, _arg_4);
+  }
+
+  else if (syscall_nr == SYS_READV || syscall_nr == SYS_WRITEV)
+  {
+    if (!(is_ptr_valid(ARG_1)) || !(is_ptr_valid(ARG_2))
+    || !(is_ptr_valid(ARG_3))) exit(-1);
+
+    int _arg_1 = *((int*)ARG_1);
+    if (!(is_fd_valid(_arg_1))) exit(-1);
+
+    struct iovec *_arg_2 = *((struct iovec**)ARG_2);
+    int _arg_3 = *((int*)ARG_3);
+
+    if (_arg_3 < 0 || _arg_3 > IOV_MAX)
+      f->eax = -1;
+    else
+    {
+      /* Copy the array so that it cannot change once checked. */
+      struct iovec iov[IOV_MAX];
+
+      if (_arg_3 > 0
+          && !(is_bufr_valid(_arg_2, _arg_3 * sizeof *_arg_2))) exit(-1);
+      memcpy (iov, _arg_2, _arg_3 * sizeof *_arg_2);
+      if (!(is_iov_valid(iov, _arg_3))) exit(-1);
+
+      if (syscall_nr == SYS_READV)
+        f->eax = readv (_arg_1, iov, _arg_3);
+      else
+        f->eax = writev (_arg_1, iov, _arg_3);
+    }
+  }
+
+  else if (syscall_nr == SYS_FALLOCATE)
+  {
+    if (!(is_ptr_valid(ARG_1)) || !(is_ptr_valid(ARG_2))
+    || !(is_ptr_valid(ARG_3)) || !(is_ptr_valid(ARG_4))) exit(-1);
+
+    int _arg_1 = *((int*)ARG_1);
+    if (!(is_fd_valid(_arg_1))) exit(-1);
+
+    int _arg_2 = *((int*)ARG_2);
+    unsigned _arg_3 = *((unsigned*)ARG_3);
+    unsigned _arg_4 = *((unsigned*)ARG_4);
+
+    f->eax = fallocate (_arg_1, _arg_2, _arg_3, _arg_4);
+  }
+
+  else if (syscall_nr == SYS_COPY_FILE_RANGE)
+  {
+    if (!(is_ptr_valid(ARG_1)) || !(is_ptr_valid(ARG_2))
+    || !(is_ptr_valid(ARG_3))) exit(-1);
+
+    int _arg_1 = *((int*)ARG_1);
+    int _arg_2 = *((int*)ARG_2);
+    if (!(is_fd_valid(_arg_1)) || !(is_fd_valid(_arg_2))) exit(-1);
+
+    unsigned _arg_3 = *((unsigned*)ARG_3);
+
+    f->eax = copy_file_range (_arg_1, _arg_2, _arg_3);
+  }
+
   else 
   {
     //printf ("Not a valid system call!\n");
@@ -255,7 +418,7 @@ int read (int fd, void *buffer, unsigned size)
   else
   {
     if (f == NULL) return -1;
-    
+    if (inode_is_dir (file_get_inode (f))) return -1;
     return file_read (f, buffer, size);
   }
 }
@@ -278,6 +441,7 @@ int write (int fd, const void *buffer, unsigned size)
   else
   {
     if (f == NULL) exit(-1);
+    if (inode_is_dir (file_get_inode (f))) return -1;
     return file_write (f, buffer, size);
   }
 }
@@ -358,6 +522,241 @@ int wait (pid_t pid)
   return process_wait(pid);
 }
 
+/* Writes all data buffered by the file system back to disk. */
+void sync (void)
+{
+  filesys_sync ();
+}
+
+/* Writes the buffered data of the open file fd back to disk.
+Returns false if fd is not an open file. */
+bool fsync (int fd)
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+
+  if (f == NULL) return false;
+
+  file_sync (f);
+  return true;
+}
+
+/* Reads size bytes from the file open as fd into buffer, starting
+at byte offset in the file, and returns the number of bytes read.
+The position of fd is neither used nor changed, so threads that
+share fd do not race on it. Returns -1 if fd is not an open file,
+or is the console or a directory. */
+int pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+
+  if (f == NULL || fd == STDOUT_FILENO) return -1;
+  if (inode_is_dir (file_get_inode (f))) return -1;
+  if ((off_t) offset < 0) return -1;
+
+  return file_read_at (f, buffer, size, offset);
+}
+
+/* Writes size bytes from buffer into the file open as fd, starting
+at byte offset in the file, and returns the number of bytes
+written. Like pread(), it leaves the position of fd alone. Returns
+-1 if fd is not an open file, or is the console or a directory. */
+int pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+
+  if (f == NULL || fd == STDOUT_FILENO) return -1;
+  if (inode_is_dir (file_get_inode (f))) return -1;
+  if ((off_t) offset < 0) return -1;
+
+  return file_write_at (f, buffer, size, offset);
+}
+
+/* Returns the total length of the iovcnt buffers in iov, or -1 if
+it does not fit in an int. */
+static int iov_total (const struct iovec *iov, int iovcnt)
+{
+  size_t total = 0;
+
+  for (int i = 0; i < iovcnt; i++)
+  {
+    if (iov[i].iov_len > INT_MAX - total) return -1;
+    total += iov[i].iov_len;
+  }
+  return total;
+}
+
+/* Reads from the file open as fd into the iovcnt buffers in iov,
+filling each in turn, and returns the number of bytes read. The
+whole transfer is a single read of the file, so no write to it can
+land between two of the buffers. Returns -1 if fd is not an open
+file or the buffers total more than INT_MAX bytes. */
+int readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+
+  if (iov_total (iov, iovcnt) < 0) return -1;
+  if (f == NULL) return -1;
+  if (inode_is_dir (file_get_inode (f))) return -1;
+  return file_readv (f, iov, iovcnt);
+}
+
+/* Writes the iovcnt buffers in iov, in order, to the file open as
+fd as a single write, and returns the number of bytes written.
+Returns -1 if fd is not an open file, is a directory, or the
+buffers total more than INT_MAX bytes. */
+int writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+  int total = iov_total (iov, iovcnt);
+
+  if (total < 0) return -1;
+
+  if (fd == STDOUT_FILENO)
+  {
+    for (int i = 0; i < iovcnt; i++)
+      putbuf (iov[i].iov_base, iov[i].iov_len);
+    return total;
+  }
+
+  if (f == NULL) return -1;
+  if (inode_is_dir (file_get_inode (f))) return -1;
+  return file_writev (f, iov, iovcnt);
+}
+
+/* Copies up to size bytes from the file open as in_fd, starting at
+its position, to the file open as out_fd at its position, and
+advances both positions. The data never passes through user memory,
+so a whole copy takes one trap. Returns the number of bytes copied,
+which is 0 at end of file, or -1 if either fd is not an open
+ordinary file or both refer to the same file. */
+int copy_file_range (int in_fd, int out_fd, unsigned size)
+{
+  struct thread *t = thread_current();
+  struct file *in = t->fd_list[in_fd];
+  struct file *out = t->fd_list[out_fd];
+
+  if (in == NULL || out == NULL) return -1;
+  if (in_fd == STDOUT_FILENO || out_fd == STDOUT_FILENO) return -1;
+  if (inode_is_dir (file_get_inode (in))
+      || inode_is_dir (file_get_inode (out))) return -1;
+  if (file_get_inode (in) == file_get_inode (out)) return -1;
+
+  if (size > INT_MAX) size = INT_MAX;
+  return file_copy (out, in, size);
+}
+
+/* Reserves disk space for the length bytes of the file open as fd
+starting at offset, as runs of consecutive sectors, so that later
+writes there need no allocation and the file stays contiguous on
+disk. Unless mode is FALLOC_KEEP_SIZE, the file is extended to
+offset + length bytes if it is shorter; the new bytes read as
+zeros. With FALLOC_KEEP_SIZE, space past the end of the file is
+reserved without being zeroed. Returns true if successful, false
+if fd is not an open ordinary file, mode is invalid, or the disk is
+full. */
+bool fallocate (int fd, int mode, unsigned offset, unsigned length)
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+
+  if (f == NULL || fd == STDOUT_FILENO) return false;
+  if (inode_is_dir (file_get_inode (f))) return false;
+  if (mode & ~FALLOC_KEEP_SIZE) return false;
+  if (offset > INT_MAX || length > INT_MAX - offset) return false;
+
+  return file_allocate (f, offset, length, mode & FALLOC_KEEP_SIZE);
+}
+
+/* Changes the current working directory of the process to dir,
+which may be relative or absolute. Returns true if successful,
+false on failure. */
+bool chdir (const char *dir)
+{
+  return filesys_chdir (dir);
+}
+
+/* Creates the directory named dir, which may be relative or
+absolute. Returns true if successful, false on failure. */
+bool mkdir (const char *dir)
+{
+  return filesys_mkdir (dir);
+}
+
+/* Reads a directory entry from fd, which must be a directory, and
+stores its null-terminated name in name. Returns false if there
+are no more entries or fd is not a directory. The entries "." and
+".." are never returned. The position of fd is used to remember
+where the next call continues. */
+bool readdir (int fd, char name[READDIR_MAX_LEN + 1])
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+  struct dir *dir;
+  bool success;
+
+  if (f == NULL || !inode_is_dir (file_get_inode (f))) return false;
+
+  dir = dir_open (inode_reopen (file_get_inode (f)));
+  if (dir == NULL) return false;
+
+  dir_seek (dir, file_tell (f));
+  success = dir_readdir (dir, name);
+  file_seek (f, dir_tell (dir));
+  dir_close (dir);
+  return success;
+}
+
+/* Reads up to cnt entries of the directory open as fd into
+entries, as if by as many calls to readdir(), and returns the
+number read. Each entry also holds the inode number of the file
+and whether it is a directory. Returns 0 at the end of the
+directory, or -1 if fd is not a directory. */
+int getdents (int fd, struct dirent *entries, unsigned cnt)
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+  struct dir *dir;
+  int entry_cnt;
+
+  if (f == NULL || !inode_is_dir (file_get_inode (f))) return -1;
+
+  dir = dir_open (inode_reopen (file_get_inode (f)));
+  if (dir == NULL) return -1;
+
+  dir_seek (dir, file_tell (f));
+  entry_cnt = dir_getdents (dir, entries, cnt);
+  file_seek (f, dir_tell (dir));
+  dir_close (dir);
+  return entry_cnt;
+}
+
+/* Returns true if fd represents a directory, false if it is an
+ordinary file or not open. */
+bool isdir (int fd)
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+
+  return f != NULL && inode_is_dir (file_get_inode (f));
+}
+
+/* Returns the inode number of the file or directory open as fd,
+or -1 if fd is not open. */
+int inumber (int fd)
+{
+  struct thread *t = thread_current();
+  struct file *f = t->fd_list[fd];
+
+  if (f == NULL) return -1;
+
+  return inode_get_inumber (file_get_inode (f));
+}
+
 
 /* ------ The following part is for input validation (Lab 5) ------ */
 
@@ -389,14 +788,31 @@ bool is_str_valid (char* str)
 }
 
 /* Checks that the given pointer to a buffer is valid. 
-   This means that every possible pointer in the buffer needs to be valid,
-   so we loop over the buffer with size and check every pointer
-   with is_ptr_valid(). */
+   This means that every possible pointer in the buffer needs to be valid.
+   Validity only changes at page boundaries, so we check the first byte
+   and then one byte in each following page with is_ptr_valid(). */
 bool is_bufr_valid (void* buffer, unsigned size)
 {
-  for (unsigned i = 0; i <= size; i++)
+  uint8_t *first = buffer;
+  uint8_t *last = first + (size > 0 ? size - 1 : 0);
+
+  if (last < first) return false;
+
+  if (!(is_ptr_valid(first))) return false;
+  for (uint8_t *p = pg_round_down (first) + PGSIZE; p <= last; p += PGSIZE)
+  {
+    if (!(is_ptr_valid(p))) return false;
+  }
+  return true;
+}
+
+/* Checks every buffer of an iovec array that has already been
+   copied into the kernel, in one pass. */
+bool is_iov_valid (const struct iovec *iov, int iovcnt)
+{
+  for (int i = 0; i < iovcnt; i++)
   {
-    if (!(is_ptr_valid(buffer + i))) return false;
+    if (!(is_bufr_valid(iov[i].iov_base, iov[i].iov_len))) return false;
   }
   return true;
 }
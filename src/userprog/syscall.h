@@ -1,6 +1,7 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include "lib/user/syscall.h"
@@ -10,6 +11,8 @@
 #include "threads/malloc.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "filesys/directory.h"
+#include "filesys/inode.h"
 #include "threads/init.h"
 #include "devices/input.h"
 #include "lib/kernel/console.h"
@@ -41,6 +44,7 @@ bool is_ptr_valid (void* esp);
 bool is_str_valid (char* str);
 bool is_bufr_valid (void* buffer, unsigned size);
 bool is_fd_valid (int fd);  
+bool is_iov_valid (const struct iovec *iov, int iovcnt);
 
 /* Lab 6 */
 void seek (int fd, unsigned position);
@@ -48,4 +52,30 @@ unsigned tell (int fd);
 int filesize (int fd);
 bool remove (const char *file_name);
 
+/* Buffer cache */
+void sync (void);
+bool fsync (int fd);
+
+/* Positional I/O */
+int pread (int fd, void *buffer, unsigned size, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned size, unsigned offset);
+
+/* Scatter/gather I/O */
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+
+/* In-kernel copy */
+int copy_file_range (int in_fd, int out_fd, unsigned size);
+
+/* Space reservation */
+bool fallocate (int fd, int mode, unsigned offset, unsigned length);
+
+/* Subdirectories */
+bool chdir (const char *dir);
+bool mkdir (const char *dir);
+bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
+bool isdir (int fd);
+int inumber (int fd);
+int getdents (int fd, struct dirent *entries, unsigned cnt);
+
 #endif /* userprog/syscall.h */
\ No newline at end of file